@@ -0,0 +1,128 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/address.h>
+#include <Wink/constants.h>
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+constexpr uint16_t kPeers = 100;
+
+// The previous Address, which held the IP as written and as resolved, and
+// resolved it again on every copy and every conversion to a sockaddr. Equality
+// is corrected to compare the IP as well as the port
+class StringAddress {
+ public:
+  StringAddress(std::string ip, uint16_t port) : port_(port) { set_ip(ip); }
+  StringAddress(const StringAddress& address) : port_(address.port_) {
+    set_ip(address.ip_);
+  }
+  StringAddress& operator=(const StringAddress& address) {
+    set_ip(address.ip_);
+    port_ = address.port_;
+    return *this;
+  }
+  void set_ip(std::string ip) {
+    ip_ = ip;
+    resolved_ = Resolve(ip_);
+  }
+  void WriteTo(struct sockaddr_in& address) const {
+    std::memset(&address, 0, sizeof(struct sockaddr_in));
+    address.sin_family = AF_INET;
+    auto c = ip_.c_str();
+    if (!isdigit(c[0])) {
+      if (const auto record = gethostbyname(c); record) {
+        c = inet_ntoa(*reinterpret_cast<in_addr*>(record->h_addr));
+      }
+    }
+    address.sin_addr.s_addr = inet_addr(c);
+    address.sin_port = htons(port_);
+  }
+  bool operator<(const StringAddress& other) const {
+    if (resolved_ == other.resolved_) {
+      return port_ < other.port_;
+    }
+    return resolved_ < other.resolved_;
+  }
+  bool operator==(const StringAddress& other) const {
+    return port_ == other.port_ && resolved_ == other.resolved_;
+  }
+  size_t Hash() const {
+    return std::hash<std::string>()(resolved_) ^ std::hash<uint16_t>()(port_);
+  }
+
+ private:
+  std::string ip_;
+  std::string resolved_;
+  uint16_t port_;
+};
+
+size_t Hash(const Address& address) { return std::hash<Address>()(address); }
+
+size_t Hash(const StringAddress& address) { return address.Hash(); }
+
+template <typename A>
+std::vector<A> Peers() {
+  std::vector<A> peers;
+  for (uint16_t p = 0; p < kPeers; p++) {
+    peers.emplace_back("10.0." + std::to_string(p % 4) + ".1", 10000 + p);
+  }
+  return peers;
+}
+
+// Measures copying an address, as done for every queued and received message.
+template <typename A>
+static void BM_AddressCopy(benchmark::State& state) {
+  const auto peers = Peers<A>();
+  size_t i = 0;
+  for (auto _ : state) {
+    A copy(peers[i++ % kPeers]);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_AddressCopy<Address>);
+BENCHMARK(BM_AddressCopy<StringAddress>);
+
+// Measures ordering and equality, as done by every lookup keyed by peer.
+template <typename A>
+static void BM_AddressCompare(benchmark::State& state) {
+  const auto peers = Peers<A>();
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto& a = peers[i % kPeers];
+    const auto& b = peers[(i * 7 + 3) % kPeers];
+    i++;
+    benchmark::DoNotOptimize(a < b);
+    benchmark::DoNotOptimize(a == b);
+  }
+}
+BENCHMARK(BM_AddressCompare<Address>);
+BENCHMARK(BM_AddressCompare<StringAddress>);
+
+// Measures hashing, as done by every lookup in an unordered container.
+template <typename A>
+static void BM_AddressHash(benchmark::State& state) {
+  const auto peers = Peers<A>();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Hash(peers[i++ % kPeers]));
+  }
+}
+BENCHMARK(BM_AddressHash<Address>);
+BENCHMARK(BM_AddressHash<StringAddress>);
+
+// Measures conversion to a socket address, as done for every datagram sent.
+template <typename A>
+static void BM_AddressWriteTo(benchmark::State& state) {
+  const auto peers = Peers<A>();
+  size_t i = 0;
+  sockaddr_in address;
+  for (auto _ : state) {
+    peers[i++ % kPeers].WriteTo(address);
+    benchmark::DoNotOptimize(address);
+  }
+}
+BENCHMARK(BM_AddressWriteTo<Address>);
+BENCHMARK(BM_AddressWriteTo<StringAddress>);
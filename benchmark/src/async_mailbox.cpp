@@ -0,0 +1,183 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/constants.h>
+#include <Wink/mailbox.h>
+#include <Wink/socket.h>
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counts the datagrams sent through a UDPSocket.
+class CountingSocket : public UDPSocket {
+ public:
+  explicit CountingSocket(Address& address) : UDPSocket(address) {}
+  bool Send(const Address& to, const char* buffer,
+            const size_t length) override {
+    const auto sent = UDPSocket::Send(to, buffer, length);
+    if (sent) {
+      packets_++;
+    }
+    return sent;
+  }
+  size_t SendBatch(const std::vector<Datagram>& datagrams,
+                   const size_t count) override {
+    const auto sent = UDPSocket::SendBatch(datagrams, count);
+    packets_ += sent;
+    return sent;
+  }
+  uint64_t packets() const { return packets_; }
+
+ private:
+  std::atomic_uint64_t packets_ = 0;
+};
+
+// Sends a burst of messages between two mailboxes over loopback per iteration,
+// and reports how many datagrams (messages and acknowledgements) each message
+// cost.
+static void BM_AsyncMailboxPacketsPerMessage(benchmark::State& state) {
+  const size_t burst = state.range(0);
+  Address sender_address(kLocalhost, 0);
+  CountingSocket sender_socket(sender_address);
+  AsyncMailbox sender(sender_socket);
+  Address receiver_address(kLocalhost, 0);
+  CountingSocket receiver_socket(receiver_address);
+  AsyncMailbox receiver(receiver_socket);
+
+  const std::string payload(64, 'x');
+  Address from;
+  Address to;
+  std::string message;
+  uint64_t messages = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < burst; i++) {
+      sender.Send(receiver_address, payload);
+    }
+    for (size_t i = 0; i < burst; i++) {
+      if (!receiver.Receive(from, to, message)) {
+        state.SkipWithError("Message lost");
+        return;
+      }
+    }
+    while (!sender.Flushed()) {
+    }
+    messages += burst;
+  }
+  state.SetItemsProcessed(messages);
+  state.counters["packets_per_message"] =
+      static_cast<double>(sender_socket.packets() + receiver_socket.packets()) /
+      messages;
+}
+BENCHMARK(BM_AsyncMailboxPacketsPerMessage)->Arg(1)->Arg(8)->Arg(64);
+
+// Sends a message to a peer and waits for its reply per iteration.
+template <typename S>
+static void BM_AsyncMailboxLatency(benchmark::State& state) {
+  Address address(kLocalhost, 0);
+  S socket(address);
+  AsyncMailbox mailbox(socket);
+  Address peer_address(kLocalhost, 0);
+  S peer_socket(peer_address);
+  AsyncMailbox peer(peer_socket);
+
+  const std::string payload(64, 'x');
+  Address from;
+  Address to;
+  std::string message;
+  for (auto _ : state) {
+    mailbox.Send(peer_address, payload);
+    if (!peer.Receive(from, to, message)) {
+      state.SkipWithError("Message lost");
+      return;
+    }
+    peer.Send(address, message);
+    if (!mailbox.Receive(from, to, message)) {
+      state.SkipWithError("Reply lost");
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AsyncMailboxLatency<UDPSocket>)->UseRealTime();
+BENCHMARK(BM_AsyncMailboxLatency<SharedMemorySocket>)->UseRealTime();
+BENCHMARK(BM_AsyncMailboxLatency<UnixSocket>)->UseRealTime();
+BENCHMARK(BM_AsyncMailboxLatency<IOUringSocket>)->UseRealTime();
+
+// Sends a burst of messages to a peer per iteration.
+template <typename S>
+static void BM_AsyncMailboxThroughput(benchmark::State& state) {
+  const size_t burst = 256;
+  Address address(kLocalhost, 0);
+  S socket(address);
+  AsyncMailbox mailbox(socket);
+  Address peer_address(kLocalhost, 0);
+  S peer_socket(peer_address);
+  AsyncMailbox peer(peer_socket);
+
+  const std::string payload(64, 'x');
+  Address from;
+  Address to;
+  std::string message;
+  for (auto _ : state) {
+    for (size_t i = 0; i < burst; i++) {
+      mailbox.Send(peer_address, payload);
+    }
+    for (size_t i = 0; i < burst; i++) {
+      if (!peer.Receive(from, to, message)) {
+        state.SkipWithError("Message lost");
+        return;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * burst);
+}
+BENCHMARK(BM_AsyncMailboxThroughput<UDPSocket>)->UseRealTime();
+BENCHMARK(BM_AsyncMailboxThroughput<SharedMemorySocket>)->UseRealTime();
+BENCHMARK(BM_AsyncMailboxThroughput<UnixSocket>)->UseRealTime();
+BENCHMARK(BM_AsyncMailboxThroughput<IOUringSocket>)->UseRealTime();
+
+// Discards everything sent through it, reaching every peer reliably so nothing
+// awaits acknowledgement, and never receives anything.
+class DiscardingSocket : public Socket {
+ public:
+  bool Receive(Address&, Address&, char*, size_t&) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return false;
+  }
+  bool ReceiveMulticast(Address&, Address&, char*, size_t&) override {
+    return false;
+  }
+  bool Send(const Address&, const char*, const size_t) override {
+    return true;
+  }
+  bool Reliable(const Address&) override { return true; }
+};
+
+// Sends a message from each of many threads at once per iteration, through a
+// single shared mailbox.
+static void BM_AsyncMailboxSendContention(benchmark::State& state) {
+  static std::unique_ptr<DiscardingSocket> socket;
+  static std::unique_ptr<AsyncMailbox> mailbox;
+  if (state.thread_index() == 0) {
+    socket = std::make_unique<DiscardingSocket>();
+    mailbox = std::make_unique<AsyncMailbox>(*socket);
+  }
+  const Address peer(kLocalhost, 10000 + state.thread_index());
+  const std::string payload(64, 'x');
+  for (auto _ : state) {
+    mailbox->Send(peer, payload);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    mailbox.reset();
+    socket.reset();
+  }
+}
+BENCHMARK(BM_AsyncMailboxSendContention)
+    ->Threads(1)
+    ->Threads(4)
+    ->Threads(16)
+    ->UseRealTime();
@@ -0,0 +1,171 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/constants.h>
+#include <Wink/machine.h>
+#include <Wink/mailbox.h>
+#include <Wink/socket.h>
+#include <Wink/state.h>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr size_t kTicks = 100;
+constexpr size_t kTypes = 16;
+
+// Sends each datagram once, without awaiting acknowledgement, so messages to
+// the parent and server, neither of which is listening, don't hold up exit.
+class UnacknowledgedSocket : public UDPSocket {
+ public:
+  explicit UnacknowledgedSocket(Address& address) : UDPSocket(address) {}
+  bool Reliable(const Address&) override { return true; }
+};
+
+// Runs a machine per iteration which, like samples/time/after.cpp, schedules a
+// message to itself with SendAfter, here kTicks times in a row, and reports how
+// late each was handled, while the given number of other messages are pending.
+static void BM_MachineTimerJitter(benchmark::State& state) {
+  const std::chrono::microseconds delay(state.range(0));
+  const size_t pending = state.range(1);
+  Address address(kLocalhost, 0);
+  UnacknowledgedSocket socket(address);
+  AsyncMailbox mailbox(socket);
+  Address parent(kLocalhost, kServerPort + 1);
+
+  // Silence the machine's logging of every message
+  const auto buffer = std::cout.rdbuf(nullptr);
+  std::vector<double> lateness;
+  for (auto _ : state) {
+    Machine m("time/After", mailbox, address, parent);
+    std::chrono::system_clock::time_point due;
+    const auto schedule = [&] {
+      due = std::chrono::system_clock::now() + delay;
+      m.SendAfter(address, "tick", delay);
+    };
+    m.AddState(State(
+        // State Name
+        "main",
+        // Parent State
+        "",
+        // On Entry Action
+        [&]() {
+          for (size_t i = 0; i < pending; i++) {
+            m.SendAfter(address, "timeout", std::chrono::hours(1));
+          }
+          schedule();
+        },
+        // On Exit Action
+        []() {},
+        // Receivers
+        {
+            {"tick",
+             [&](const Address& from, const Address& to, std::istream& args) {
+               const std::chrono::duration<double, std::micro> late =
+                   std::chrono::system_clock::now() - due;
+               lateness.push_back(late.count());
+               if (lateness.size() % kTicks == 0) {
+                 m.Exit();
+               } else {
+                 schedule();
+               }
+             }},
+        }));
+    m.Start();
+  }
+  std::cout.rdbuf(buffer);
+  std::cout.clear();
+
+  std::sort(lateness.begin(), lateness.end());
+  double total = 0;
+  for (const auto l : lateness) {
+    total += l;
+  }
+  state.counters["mean_us"] = total / lateness.size();
+  state.counters["p99_us"] = lateness[lateness.size() * 99 / 100];
+  state.counters["max_us"] = lateness.back();
+}
+BENCHMARK(BM_MachineTimerJitter)
+    ->Args({100, 0})
+    ->Args({1000, 0})
+    ->Args({10000, 0})
+    ->Args({1000, 10000})
+    ->Args({1000, 100000})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Hands the machine a batch of the same message for as long as the benchmark
+// keeps running, then tells it to exit, without touching a socket.
+class RepeatingMailbox : public Mailbox {
+ public:
+  RepeatingMailbox(benchmark::State& state, const std::string& message)
+      : state_(state), message_(message) {}
+  bool Receive(Address& from, Address& to, std::string& message) override {
+    message = state_.KeepRunning() ? message_ : "exit";
+    return true;
+  }
+  size_t ReceiveBatch(
+      std::vector<ReceivedMessage>& messages, const size_t max,
+      const std::chrono::system_clock::time_point deadline) override {
+    messages.clear();
+    while (messages.size() < max) {
+      auto& m = messages.emplace_back();
+      Receive(m.from, m.to, m.message);
+      if (m.message == "exit") {
+        break;
+      }
+    }
+    return messages.size();
+  }
+  void Send(const Address& to, const std::string& message,
+            const Priority priority) override {}
+  bool Flushed() override { return true; }
+
+ private:
+  benchmark::State& state_;
+  const std::string message_;
+};
+
+// Dispatches messages to a machine in the leaf of a hierarchy of the given
+// depth, like samples/hierarchy/forrest.cpp but deeper, which are received
+// by the root. Each state receives kTypes other messages.
+static void BM_MachineDispatch(benchmark::State& state) {
+  const size_t depth = state.range(0);
+  RepeatingMailbox mailbox(state, "work 42");
+  Address address(kLocalhost, 0);
+  Address parent(kLocalhost, 0);
+  Machine m("hierarchy/Forrest", mailbox, address, parent);
+
+  uint64_t work = 0;
+  const Receiver ignore = [](const Address&, const Address&, std::istream&) {};
+  for (size_t level = depth; level-- > 0;) {
+    ReceiverMap receivers;
+    for (size_t t = 0; t < kTypes; t++) {
+      receivers.emplace("type" + std::to_string(level * kTypes + t), ignore);
+    }
+    if (level == 0) {
+      receivers.emplace("work", [&work](const Address&, const Address&,
+                                        std::istream& args) { work++; });
+    }
+    m.AddState(State(
+        // State Name
+        "State" + std::to_string(level),
+        // Parent State
+        level == 0 ? "" : "State" + std::to_string(level - 1),
+        // On Entry Action
+        []() {},
+        // On Exit Action
+        []() {},
+        // Receivers
+        receivers));
+  }
+
+  // Silence the machine's logging of every message
+  const auto buffer = std::cout.rdbuf(nullptr);
+  m.Start();
+  std::cout.rdbuf(buffer);
+  std::cout.clear();
+  state.SetItemsProcessed(work);
+}
+BENCHMARK(BM_MachineDispatch)->Arg(1)->Arg(4)->Arg(16);
@@ -0,0 +1,39 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/constants.h>
+#include <Wink/outbox.h>
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+constexpr uint16_t kPeers = 100;
+
+// Measures the cost of retiring one acknowledged message while the number of
+// messages in flight is held constant.
+static void BM_OutboxAcknowledge(benchmark::State& state) {
+  const auto in_flight = state.range(0);
+  std::vector<Address> peers;
+  for (uint16_t p = 0; p < kPeers; p++) {
+    peers.emplace_back(kLocalhost, 10000 + p);
+  }
+  std::vector<uint64_t> seq_nums(kPeers, 0);
+
+  Outbox outbox;
+  for (int64_t i = 0; i < in_flight; i++) {
+    const auto p = i % kPeers;
+    outbox.Push(QueuedMessage{std::chrono::system_clock::now(),
+                              seq_nums[p]++, 0, Address(), peers[p], "test"});
+  }
+
+  // Acknowledge the oldest message of each peer in turn, and replace it.
+  std::vector<uint64_t> acked(kPeers, 0);
+  int64_t i = 0;
+  for (auto _ : state) {
+    const auto p = i++ % kPeers;
+    benchmark::DoNotOptimize(outbox.Acknowledge(peers[p], acked[p]++));
+    outbox.Push(QueuedMessage{std::chrono::system_clock::now(), seq_nums[p]++,
+                              0, Address(), peers[p], "test"});
+  }
+  state.counters["in_flight"] = outbox.size();
+}
+BENCHMARK(BM_OutboxAcknowledge)->RangeMultiplier(10)->Range(100, 100000);
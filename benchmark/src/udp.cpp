@@ -0,0 +1,76 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/constants.h>
+#include <Wink/socket.h>
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+constexpr size_t kPayload = 64;
+
+// Sends and receives kMaxBatchSize datagrams over loopback per iteration, one
+// syscall per datagram.
+static void BM_UDPSocketSingle(benchmark::State& state) {
+  Address sender_address(kLocalhost, 0);
+  UDPSocket sender(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver(receiver_address);
+
+  std::string payload(kPayload, 'x');
+  std::vector<char> buffer(kMaxUDPPayload);
+  Address from;
+  Address to;
+  size_t length;
+  for (auto _ : state) {
+    for (size_t i = 0; i < kMaxBatchSize; i++) {
+      sender.Send(receiver_address, payload.data(), payload.length());
+    }
+    for (size_t i = 0; i < kMaxBatchSize; i++) {
+      if (!receiver.Receive(from, to, buffer.data(), length)) {
+        state.SkipWithError("Datagram lost");
+        return;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kMaxBatchSize);
+}
+BENCHMARK(BM_UDPSocketSingle);
+
+// Sends and receives kMaxBatchSize datagrams over loopback per iteration, with
+// sendmmsg and recvmmsg, or through io_uring.
+template <typename S>
+static void BM_UDPSocketBatch(benchmark::State& state) {
+  Address sender_address(kLocalhost, 0);
+  S sender(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  S receiver(receiver_address);
+
+  std::string payload(kPayload, 'x');
+  std::vector<Datagram> outgoing(kMaxBatchSize);
+  for (auto& d : outgoing) {
+    d.to = receiver_address;
+    d.buffer = payload.data();
+    d.length = payload.length();
+  }
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> incoming(kMaxBatchSize);
+  for (auto _ : state) {
+    sender.SendBatch(outgoing, kMaxBatchSize);
+    size_t received = 0;
+    while (received < kMaxBatchSize) {
+      incoming.resize(kMaxBatchSize - received);
+      for (size_t i = 0; i < incoming.size(); i++) {
+        incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+      }
+      const auto count = receiver.ReceiveBatch(incoming);
+      if (count == 0) {
+        state.SkipWithError("Datagram lost");
+        return;
+      }
+      received += count;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kMaxBatchSize);
+}
+BENCHMARK(BM_UDPSocketBatch<UDPSocket>);
+BENCHMARK(BM_UDPSocketBatch<IOUringSocket>);
@@ -8,83 +8,74 @@
 #include <netdb.h>
 #include <netinet/in.h>
 
+#include <compare>
+#include <cstddef>
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <type_traits>
 
 std::string Resolve(const std::string ip);
 
+/**
+ * IPv4 address and port, held as integers so addresses are cheap to copy,
+ * compare and hash. Hostnames are resolved once, when the address is set, and
+ * the address is only converted to a string for display.
+ *
+ * Hostnames are resolved through Resolver::Instance(), so its background
+ * refreshes only reach addresses set afterwards; an address holding a
+ * hostname's IP keeps it until it is set again.
+ */
 class Address {
  public:
-  Address() {
-    set_ip(kLocalhost);
-    set_port(0);
-  }
+  Address() : ip_(inet_addr(kLocalhost)) {}
   explicit Address(std::string address) { FromString(address); }
-  Address(std::string ip, uint16_t port) {
-    set_ip(ip);
-    set_port(port);
-  }
-  Address(const Address& address) {
-    set_ip(address.ip_);
-    set_port(address.port_);
-  }
-  Address(Address&& address) {
-    set_ip(address.ip_);
-    set_port(address.port_);
-  }
-  Address& operator=(const Address& address) {
-    set_ip(address.ip_);
-    set_port(address.port_);
-    return *this;
-  }
-  Address& operator=(Address&& address) {
-    set_ip(address.ip_);
-    set_port(address.port_);
-    return *this;
-  }
-  ~Address() {}
+  Address(std::string ip, uint16_t port) : port_(port) { set_ip(ip); }
 
   void FromString(const std::string& address);
   std::string ToString() const;
-  void ReadFrom(const struct sockaddr_in& address);
-  void WriteTo(struct sockaddr_in& address) const;
-  uint32_t ToInetAddr() const;
-  bool IsMulticast() const;
-
-  void set_ip(std::string ip) {
-    ip_ = ip;
-    resolved_ = Resolve(ip_);
+  void ReadFrom(const struct sockaddr_in& address) {
+    ip_ = address.sin_addr.s_addr;
+    port_ = ntohs(address.sin_port);
   }
-  void set_port(uint16_t port) { port_ = port; }
-  std::string ip() const { return ip_; }
-  uint16_t port() const { return port_; }
-
-  bool operator<(const Address& other) const {
-    if (resolved_ == other.resolved_) {
-      return port_ < other.port_;
-    }
-    return resolved_ < other.resolved_;
+  void WriteTo(struct sockaddr_in& address) const {
+    address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = ip_;
+    address.sin_port = htons(port_);
   }
+  // Returns the IP address in network byte order
+  uint32_t ToInetAddr() const { return ip_; }
+  bool IsMulticast() const { return IN_MULTICAST(ntohl(ip_)); }
 
-  bool operator==(const Address& other) const {
-    if (port_ == other.port_) {
-      return true;
-    }
-    if (ip_ == other.ip_) {
-      return true;
-    }
-    return resolved_ == other.resolved_;
-  }
+  /**
+   * Sets the IP address, resolving it if it is a hostname. Throws
+   * std::invalid_argument if the hostname can't be resolved.
+   */
+  void set_ip(std::string ip);
+  void set_port(uint16_t port) { port_ = port; }
+  std::string ip() const;
+  uint16_t port() const { return port_; }
 
-  bool operator!=(const Address& other) const { return !(*this == other); }
+  auto operator<=>(const Address& other) const = default;
 
  private:
-  std::string ip_ = kLocalhost;
-  std::string resolved_ = kLocalhost;
+  // Network byte order
+  uint32_t ip_ = 0;
   uint16_t port_ = 0;
 };
 
+static_assert(std::is_trivially_copyable_v<Address>);
+
+template <>
+struct std::hash<Address> {
+  size_t operator()(const Address& address) const {
+    return std::hash<uint64_t>()(
+        static_cast<uint64_t>(address.ToInetAddr()) << 16 | address.port());
+  }
+};
+
 std::istream& operator>>(std::istream& is, Address& address);
 std::ostream& operator<<(std::ostream& os, const Address& address);
 
@@ -2,16 +2,81 @@
 #ifndef INCLUDE_WINK_CONSTANTS_H_
 #define INCLUDE_WINK_CONSTANTS_H_
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 
 constexpr size_t kMaxUDPPayload = 65507;
 
+constexpr size_t kMaxBatchSize = 32;
+
+// Consecutive datagrams to the same peer are sent as one, and segmented by the
+// kernel or network card, if each fits in an Ethernet frame
+constexpr size_t kMaxSegmentSize = 1472;
+constexpr size_t kMaxSegments = 64;
+
+// Small messages to the same peer are packed into shared datagrams up to this
+// size
+constexpr size_t kMaxPackedSize = kMaxSegmentSize;
+
+constexpr size_t kSharedMemoryRingSize = 1 << 22;
+
+// Must be a power of two
+constexpr uint16_t kIOUringBufferCount = 64;
+
+// Capacity of the queues between senders and a mailbox's sender thread, and
+// between its receiver threads and Receive. Must be a power of two
+constexpr size_t kQueueCapacity = 4096;
+
 constexpr uint8_t kMaxRetries = 5;
 
+// Senders wait once this many messages are awaiting acknowledgement from a
+// single peer, or from all peers
+constexpr size_t kMaxOutgoingPerPeer = 4096;
+constexpr size_t kMaxOutgoing = 65536;
+
 constexpr std::chrono::seconds kNoTimeout(0);  // Unlimited
 constexpr std::chrono::seconds kSendTimeout(1);
 constexpr std::chrono::seconds kReceiveTimeout(2);
+// Most messages a machine handles between checks of its children and schedule
+constexpr size_t kReceiveBatch = 64;
+
+// Retransmission timeouts adapt to each peer's round trip time within these.
+// The floor keeps kMaxRetries doubling retries spanning several seconds, even
+// to peers on loopback.
+constexpr std::chrono::milliseconds kInitialRetransmitTimeout(500);
+constexpr std::chrono::milliseconds kMinRetransmitTimeout(200);
+constexpr std::chrono::seconds kMaxRetransmitTimeout(60);
+
+// Messages a reliable peer couldn't take yet are sent again after this long
+constexpr std::chrono::milliseconds kBusyRetryInterval(1);
+
+// Ordered mailboxes hold messages back at most this long waiting for earlier
+// ones: the span over which a sender tries kMaxRetries times before giving up,
+// starting from kInitialRetransmitTimeout and doubling with the greatest
+// jitter. Senders to peers whose round trips are slower than that allows may
+// still be retrying after this
+constexpr std::chrono::milliseconds kReorderTimeout = [] {
+  std::chrono::milliseconds span(0);
+  std::chrono::milliseconds timeout = kInitialRetransmitTimeout;
+  for (uint8_t i = 0; i < kMaxRetries; i++) {
+    span += timeout + timeout / 4;
+    timeout = std::min<std::chrono::milliseconds>(2 * timeout,
+                                                  kMaxRetransmitTimeout);
+  }
+  return span;
+}();
+
+// Acknowledgements are delayed so several messages can be acknowledged at once
+constexpr std::chrono::milliseconds kAckDelay(2);
+
+// New messages wait this long for others to pack with them, zero packs only
+// those already queued
+constexpr std::chrono::microseconds kPackDelay(0);
+
+// Resolved hostnames are cached for this long, and refreshed in the background
+// while in use
+constexpr std::chrono::seconds kResolveTTL(60);
 
 constexpr std::chrono::seconds kHeartbeatTimeout(60);
 constexpr std::chrono::seconds kPulseInterval(10);
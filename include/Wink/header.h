@@ -0,0 +1,59 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_HEADER_H_
+#define INCLUDE_WINK_HEADER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint8_t kWireVersion = 1;
+
+// Encoded length of a Header
+constexpr size_t kHeaderLength = 16;
+
+enum class MessageType : uint8_t {
+  // Sequenced message, which is acknowledged and retransmitted until it is
+  kData = 0,
+  // Acknowledgement of the data messages up to the sequence number, followed
+  // by the optional 64-bit selective bitmap as its payload
+  kAck = 1,
+  // Message sent once without a sequence number, and so neither acknowledged
+  // nor retransmitted; used for multicasts, and for unicasts to peers reached
+  // over a transport that doesn't lose or reorder them
+  kUnsequenced = 2,
+};
+
+/**
+ * Describes each message in a datagram, which holds one or more messages each
+ * with its own header followed immediately by its payload.
+ *
+ * Encoded in network byte order at fixed offsets:
+ *   0: version
+ *   1: type
+ *   2: flags
+ *   3: lane
+ *   4: payload length (16 bits)
+ *   6: reserved for future fields (16 bits, zero)
+ *   8: sequence number (64 bits)
+ */
+struct Header {
+  uint8_t version = kWireVersion;
+  MessageType type = MessageType::kData;
+  // None defined yet, unknown flags are ignored
+  uint8_t flags = 0;
+  uint8_t lane = 0;
+  uint16_t length = 0;
+  uint64_t seq_num = 0;
+
+  /**
+   * Encodes the header into the first kHeaderLength bytes of buffer.
+   */
+  void WriteTo(char* buffer) const;
+  /**
+   * Decodes the header from the start of buffer, which holds size bytes.
+   * Returns false if buffer is too short to hold the header and its payload,
+   * or the header is of an unsupported version.
+   */
+  bool ReadFrom(const char* buffer, const size_t size);
+};
+
+#endif  // INCLUDE_WINK_HEADER_H_
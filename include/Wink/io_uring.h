@@ -0,0 +1,89 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_IO_URING_H_
+#define INCLUDE_WINK_IO_URING_H_
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Submission and completion queues shared with the kernel, through which
+ * operations are submitted and completed in batches with a single system call,
+ * or none at all for multishot operations.
+ *
+ * Not thread safe, each thread should use its own IOUring or lock.
+ */
+class IOUring {
+ public:
+  /**
+   * Creates a ring with room for at least the given number of submissions.
+   * Throws if the kernel doesn't support io_uring.
+   */
+  explicit IOUring(const unsigned entries);
+  IOUring(const IOUring&) = delete;
+  IOUring(IOUring&&) = delete;
+  IOUring& operator=(const IOUring&) = delete;
+  IOUring& operator=(IOUring&&) = delete;
+  ~IOUring();
+  int fd() const { return fd_; }
+  /**
+   * Returns true if the kernel supports the given operation.
+   */
+  bool Supports(const uint8_t opcode) const;
+  /**
+   * Returns the next submission to fill in, or nullptr if the submission queue
+   * is full.
+   */
+  io_uring_sqe* Prepare();
+  /**
+   * Submits all prepared submissions, and waits for the given number of
+   * completions. Returns false if the submissions couldn't be submitted.
+   */
+  bool Submit(const unsigned wait = 0);
+  /**
+   * Removes the next completion into cqe. Returns false if there are none.
+   */
+  bool Complete(io_uring_cqe& cqe);
+  /**
+   * Provides count buffers of size bytes each from buffers to operations that
+   * select a buffer from the given group. Returns false if the kernel doesn't
+   * support provided buffer rings.
+   */
+  bool Provide(const uint16_t group, char* buffers, const uint32_t size,
+               const uint16_t count);
+  /**
+   * Returns the buffer with the given id, selected by a completed operation,
+   * to the provided buffers.
+   */
+  void Return(const uint16_t id);
+
+ private:
+  int fd_ = -1;
+  io_uring_params params_ = {};
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+  // Submissions prepared but not yet submitted
+  unsigned prepared_ = 0;
+  std::vector<uint8_t> supported_;
+  // Not io_uring_buf_ring, which C++ lays out with a padding byte before the
+  // buffers that C doesn't have
+  io_uring_buf* buffer_ring_ = nullptr;
+  size_t buffer_ring_size_ = 0;
+  char* buffers_ = nullptr;
+  uint32_t buffer_size_ = 0;
+  uint16_t buffer_count_ = 0;
+};
+
+#endif  // INCLUDE_WINK_IO_URING_H_
@@ -7,16 +7,20 @@
 #include <Wink/log.h>
 #include <Wink/mailbox.h>
 #include <Wink/state.h>
+#include <Wink/timer.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <csignal>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -67,19 +71,42 @@ class Machine {
    */
   void Transition(const std::string& state);
   /**
-   * Transmits a message to the given address.
+   * Transmits a message to the given address, in the given priority's lane.
    */
-  void Send(const Address& to, const std::string& message);
+  void Send(const Address& to, const std::string& message,
+            const Priority priority = Priority::kNormal);
   /**
-   * Sends the given address the message at the given time.
+   * Transmits a message to the given address if the mailbox has room for it by
+   * the given deadline. Returns false if the message wasn't sent, so producers
+   * can slow down instead of queuing without limit.
    */
-  void SendAt(const Address& to, const std::string& message,
-              const std::chrono::system_clock::time_point time);
+  bool TrySend(const Address& to, const std::string& message,
+               const std::chrono::system_clock::time_point deadline);
   /**
-   * Sends the given address the message after the given delay.
+   * Sends the given address the message at the given time. Returns a handle
+   * with which to cancel it.
    */
-  void SendAfter(const Address& to, const std::string& message,
-                 const std::chrono::seconds delay);
+  uint64_t SendAt(const Address& to, const std::string& message,
+                  const std::chrono::system_clock::time_point time);
+  /**
+   * Sends the given address the message after the given delay, which may be
+   * as short as a microsecond. Returns a handle with which to cancel it.
+   */
+  uint64_t SendAfter(const Address& to, const std::string& message,
+                     const std::chrono::system_clock::duration delay);
+  /**
+   * Sends the given address the message every period, starting one period from
+   * now, until cancelled. Each send is scheduled a whole period after the one
+   * before was due, so late sends don't delay the rest, and any missed while
+   * the machine was busy are skipped. Returns a handle with which to cancel it.
+   */
+  uint64_t SendEvery(const Address& to, const std::string& message,
+                     const std::chrono::system_clock::duration period);
+  /**
+   * Cancels the scheduled message with the given handle. Returns false if it
+   * has already been sent, or cancelled.
+   */
+  bool Cancel(const uint64_t handle);
   /**
    * Spawns a new state machine.
    */
@@ -103,13 +130,20 @@ class Machine {
   void CheckChildren(const std::chrono::system_clock::time_point now);
   void SendPulse();
   void SendScheduled(const std::chrono::system_clock::time_point now);
-  void ReceiveMessage(const std::chrono::system_clock::time_point now);
+  uint64_t Schedule(const Address& to, const std::string& message,
+                    const std::chrono::system_clock::time_point time,
+                    const std::chrono::system_clock::duration period);
+  std::chrono::system_clock::time_point NextDeadline(
+      const std::chrono::system_clock::time_point now,
+      const std::chrono::system_clock::time_point pulse);
+  void ReceiveMessages(const std::chrono::system_clock::time_point deadline);
   void HandleMessage(const std::chrono::system_clock::time_point now,
                      const Address& from, const Address& to,
                      const std::string& message);
   void RegisterMachine(const std::string& machine, const int pid);
   void UnregisterMachine();
   std::vector<std::string> StateLineage(const std::string& state);
+  void Compile();
 
   std::string name_ = "";
   Mailbox& mailbox_;
@@ -119,13 +153,42 @@ class Machine {
   std::atomic_bool running_ = true;
   std::map<const std::string, State> states_;
   std::string current_ = "";
+  // Receivers of each state flattened with those it inherits, so a message is
+  // dispatched with one lookup however deep the hierarchy
+  struct Dispatch {
+    // Indexed by interned message type, null for types handled by wildcard
+    std::vector<const Receiver*> receivers;
+    // Receives the types above without a receiver, if any do
+    const Receiver* wildcard = nullptr;
+    // Set if the state's lineage names a state that wasn't added
+    std::string missing;
+  };
+  // Rebuilt whenever a state is added
+  bool compiled_ = false;
+  std::unordered_map<std::string, size_t> types_;
+  std::map<const std::string, Dispatch> dispatch_;
+  // Cleared on each transition, and looked up by the next message
+  const Dispatch* current_dispatch_ = nullptr;
   std::string error_message_ = "";
   struct ScheduledMessage {
-    const Address& address;
-    const std::string message;
-    const std::chrono::system_clock::time_point time;
+    Address address;
+    std::string message;
+    std::chrono::system_clock::time_point time;
+    // Zero unless sent repeatedly
+    std::chrono::system_clock::duration period;
+    // Identifies the message's current deadline in timers_
+    uint64_t timer;
   };
-  std::vector<ScheduledMessage> queue_;
+  // Guards scheduled_ and timers_, as messages may be scheduled from any
+  // thread
+  std::mutex timers_mutex_;
+  std::unordered_map<uint64_t, ScheduledMessage> scheduled_;
+  // Holds the handle of each scheduled message until it's due
+  TimerWheel<uint64_t, std::chrono::microseconds> timers_;
+  uint64_t next_handle_ = 0;
+  std::vector<uint64_t> due_;
+  // Reused by each batch, to save reallocating it
+  std::vector<ReceivedMessage> received_;
   std::map<const std::string,
            std::pair<const std::string, std::chrono::system_clock::time_point>>
       spawned_;
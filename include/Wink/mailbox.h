@@ -4,15 +4,47 @@
 
 #include <Wink/address.h>
 #include <Wink/constants.h>
+#include <Wink/outbox.h>
+#include <Wink/queue.h>
+#include <Wink/rtt.h>
+#include <Wink/sequence.h>
 #include <Wink/socket.h>
+#include <Wink/window.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <random>
+#include <set>
 #include <string>
 #include <thread>
+#include <vector>
+
+/**
+ * Lanes in which messages travel. Each lane has its own sequence numbers and
+ * queues, and messages in higher lanes are sent and delivered ahead of those in
+ * lower lanes, so control messages are never stuck behind bulk traffic.
+ */
+enum class Priority : uint8_t {
+  kNormal = 0,
+  kHigh = 1,
+};
+
+constexpr size_t kPriorities = 2;
+
+/**
+ * Message received by a mailbox, with the addresses it was sent from and to.
+ */
+struct ReceivedMessage {
+  Address from;
+  Address to;
+  std::string message;
+};
 
 class Mailbox {
  public:
@@ -22,50 +54,227 @@ class Mailbox {
   Mailbox& operator=(const Mailbox&) = delete;
   Mailbox& operator=(Mailbox&&) = delete;
   virtual ~Mailbox() {}
+  /**
+   * Receives a message, waiting up to kReceiveTimeout for one to arrive.
+   * Returns false if none arrived.
+   */
   virtual bool Receive(Address& from, Address& to, std::string& message) = 0;
-  virtual void Send(const Address& to, const std::string& message) = 0;
+  /**
+   * Receives a message, waiting until the given deadline for one to arrive.
+   * Returns false if none arrived. A deadline of now never waits.
+   */
+  virtual bool Receive(Address& from, Address& to, std::string& message,
+                       const std::chrono::system_clock::time_point deadline) {
+    return Receive(from, to, message);
+  }
+  /**
+   * Replaces the contents of messages with up to max received messages,
+   * waiting as Receive does for the first. Returns the number received.
+   */
+  size_t ReceiveBatch(std::vector<ReceivedMessage>& messages,
+                      const size_t max) {
+    return ReceiveBatch(messages, max,
+                        std::chrono::system_clock::now() + kReceiveTimeout);
+  }
+  /**
+   * Replaces the contents of messages with up to max received messages,
+   * waiting until the given deadline for the first. Returns the number
+   * received.
+   */
+  virtual size_t ReceiveBatch(
+      std::vector<ReceivedMessage>& messages, const size_t max,
+      const std::chrono::system_clock::time_point deadline) {
+    messages.clear();
+    if (max == 0) {
+      return 0;
+    }
+    auto& m = messages.emplace_back();
+    if (!Receive(m.from, m.to, m.message, deadline)) {
+      messages.clear();
+      return 0;
+    }
+    return 1;
+  }
+  /**
+   * Sends the message to the given address in the normal priority lane.
+   */
+  void Send(const Address& to, const std::string& message) {
+    Send(to, message, Priority::kNormal);
+  }
+  /**
+   * Sends the message to the given address in the given priority's lane.
+   */
+  virtual void Send(const Address& to, const std::string& message,
+                    const Priority priority) = 0;
+  /**
+   * Sends the message to the given address if there is room to queue it by the
+   * given deadline. Returns false if the message would still block, in which
+   * case it isn't sent. A deadline of now never waits.
+   */
+  virtual bool TrySend(const Address& to, const std::string& message,
+                       const std::chrono::system_clock::time_point deadline) {
+    Send(to, message);
+    return true;
+  }
   virtual bool Flushed() = 0;
 };
 
 class AsyncMailbox : public Mailbox {
  public:
-  explicit AsyncMailbox(Socket& socket);
+  /**
+   * Creates a mailbox sending and receiving through the given socket. If
+   * ordered, messages from each peer are delivered in the order they were sent,
+   * otherwise they are delivered as soon as they arrive.
+   *
+   * Once peer_limit normal priority messages to a peer, or limit messages in
+   * total, are awaiting acknowledgement, Send blocks until there is room.
+   */
+  explicit AsyncMailbox(Socket& socket, const bool ordered = false,
+                        const size_t peer_limit = kMaxOutgoingPerPeer,
+                        const size_t limit = kMaxOutgoing);
   AsyncMailbox(const AsyncMailbox&) = delete;
   AsyncMailbox(AsyncMailbox&&) = delete;
   AsyncMailbox& operator=(const AsyncMailbox&) = delete;
   AsyncMailbox& operator=(AsyncMailbox&&) = delete;
   ~AsyncMailbox();
+  using Mailbox::ReceiveBatch;
+  using Mailbox::Send;
   bool Receive(Address& from, Address& to, std::string& message) override;
-  void Send(const Address& to, const std::string& message) override;
+  bool Receive(Address& from, Address& to, std::string& message,
+               const std::chrono::system_clock::time_point deadline) override;
+  /**
+   * Moves up to max received messages out under a single lock, highest lane
+   * first, so a busy receiver isn't woken once per message.
+   */
+  size_t ReceiveBatch(
+      std::vector<ReceivedMessage>& messages, const size_t max,
+      const std::chrono::system_clock::time_point deadline) override;
+  void Send(const Address& to, const std::string& message,
+            const Priority priority) override;
+  bool TrySend(const Address& to, const std::string& message,
+               const std::chrono::system_clock::time_point deadline) override;
   bool Flushed() override;
+  /**
+   * Returns the round trip time statistics of each peer this mailbox has sent
+   * messages to.
+   */
+  std::map<Address, RoundTrip> RoundTrips();
+  /**
+   * Packs small messages to the same peer into datagrams of up to size bytes,
+   * holding new messages for up to delay in case others follow them. A delay
+   * of zero packs only the messages already queued.
+   */
+  void SetPackBudget(const size_t size, const std::chrono::microseconds delay);
+  /**
+   * Sets whether messages to the given peer are packed, which they are unless
+   * disabled for peers that can't afford the delay.
+   */
+  void SetPacking(const Address& peer, const bool packing);
 
  private:
-  void BackgroundReceive();
-  void BackgroundReceiveMulticast();
+  bool Pop(QueuedMessage& message);
+  bool AwaitPop(std::unique_lock<std::mutex>& lock, QueuedMessage& message,
+                const std::chrono::system_clock::time_point deadline);
+  size_t Outgoing() const;
+  bool Room(const Address& to, const Priority priority) const;
+  bool Submit(const Address& to, const std::string& message,
+              const Priority priority);
+  void Drain();
+  void Queue(const Address& to, std::string message, const Priority priority);
+  void QueueSequenced(const size_t lane, const Address& to,
+                      std::string message);
+  void WakeReceiver();
+  void Deliver(const Address& to, const std::string& message,
+               const Priority priority);
+  void BackgroundReceive(const size_t shard, std::vector<char>& buffers,
+                         std::vector<Datagram>& datagrams);
+  // Delivers the messages held from the given peer that are no longer waiting
+  // on earlier ones
+  void Release(const size_t lane, const Address& from,
+               std::map<uint64_t, QueuedMessage, SequenceLess>& held,
+               const std::chrono::system_clock::time_point now,
+               std::vector<QueuedMessage>& delivered);
   void BackgroundSend();
-  void BackgroundSendMulticast();
-  struct QueuedMessage {
-    std::chrono::system_clock::time_point time;
-    uint64_t seq_num;
-    uint8_t attempts;
-    Address from;
-    Address to;
-    std::string message;
-  };
+  void BackgroundSendUnacknowledged(const size_t lane,
+                                    std::deque<QueuedMessage>& messages);
   Socket& socket_;
-  char receive_buffer_[kMaxUDPPayload];
-  char send_buffer_[kMaxUDPPayload];
+  const bool ordered_;
+  const size_t peer_limit_;
+  const size_t limit_;
+  std::vector<char> ack_buffers_;
+  std::vector<Datagram> acks_;
+  std::vector<std::string> send_buffers_;
+  std::vector<Datagram> sends_;
   std::mutex incoming_mutex_;
   std::mutex outgoing_mutex_;
+  // Waited on by Receive, and only notified while it waits
   std::condition_variable incoming_condition_;
+  std::atomic_size_t receivers_waiting_ = 0;
+  // Waited on by receiver threads for room to deliver, and only notified while
+  // they wait
+  std::condition_variable room_condition_;
+  std::atomic_size_t deliverers_waiting_ = 0;
+  // Waited on by callers for room to send, or for the mailbox to be flushed
   std::condition_variable outgoing_condition_;
-  std::deque<QueuedMessage> incoming_messages_;
-  std::deque<QueuedMessage> outgoing_messages_;
-  std::deque<QueuedMessage> outgoing_multicasts_;
-  std::map<const Address, uint64_t> incoming_seq_nums_;
-  std::map<const Address, uint64_t> outgoing_seq_nums_;
+  // Waited on by the sender thread, and only notified while it waits
+  std::condition_variable sender_condition_;
+  std::atomic_bool sender_waiting_ = false;
+  struct Submission {
+    Address to;
+    std::string message;
+    Priority priority;
+  };
+  // Messages sent without taking outgoing_mutex_, which whoever holds it
+  // queues in the order they were sent
+  MPSCQueue<Submission> submissions_;
+  // Messages queued and awaiting acknowledgement, so senders can tell there's
+  // room without taking outgoing_mutex_
+  std::atomic_size_t outgoing_size_ = 0;
+  // Each of the following is kept for each lane, indexed by priority
+  std::array<MPSCQueue<QueuedMessage>, kPriorities> incoming_messages_;
+  // Messages sent to ourselves, guarded by incoming_mutex_
+  std::array<std::deque<QueuedMessage>, kPriorities> incoming_self_;
+  std::array<Outbox, kPriorities> outgoing_messages_;
+  // Multicasts, and messages to peers the socket reaches reliably, which are
+  // sent once without a sequence number
+  std::array<std::deque<QueuedMessage>, kPriorities> outgoing_unacknowledged_;
+  // Set while a reliable peer is busy, when to send its messages again
+  std::chrono::system_clock::time_point unacknowledged_retry_;
+  std::array<std::map<const Address, ReceiveWindow>, kPriorities>
+      incoming_windows_;
+  // Messages held back until the messages sent before them are delivered
+  std::array<
+      std::map<const Address, std::map<uint64_t, QueuedMessage, SequenceLess>>,
+      kPriorities>
+      incoming_reordering_;
+  // Number of messages held back, so receivers can tell when to release them
+  // without taking outgoing_mutex_
+  std::atomic_size_t incoming_held_ = 0;
+  struct PendingAck {
+    std::chrono::system_clock::time_point due;
+    // Number of messages the acknowledgement will cover
+    uint64_t messages;
+  };
+  // Peers owed an acknowledgement
+  std::array<std::map<const Address, PendingAck>, kPriorities> pending_acks_;
+  std::array<std::map<const Address, uint64_t>, kPriorities>
+      outgoing_seq_nums_;
+  struct PendingPack {
+    std::chrono::system_clock::time_point flush;
+    size_t bytes;
+    std::vector<uint64_t> seq_nums;
+  };
+  // New messages held back for packing, which aren't scheduled until sent
+  std::array<std::map<const Address, PendingPack>, kPriorities> pending_packs_;
+  size_t pack_size_ = kMaxPackedSize;
+  std::chrono::microseconds pack_delay_ = kPackDelay;
+  std::set<Address> unpacked_;
+  bool outgoing_queued_ = false;
+  std::map<const Address, RoundTrip> round_trips_;
+  std::minstd_rand random_;
   std::atomic_bool running_ = true;
-  std::thread receiver_;
+  // One for each of the socket's shards, all feeding the same incoming queues
+  std::vector<std::thread> receivers_;
   std::thread sender_;
 };
 
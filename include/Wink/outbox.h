@@ -0,0 +1,127 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_OUTBOX_H_
+#define INCLUDE_WINK_OUTBOX_H_
+
+#include <Wink/address.h>
+#include <Wink/sequence.h>
+#include <Wink/timer.h>
+#include <Wink/window.h>
+
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct QueuedMessage {
+  std::chrono::system_clock::time_point time;
+  uint64_t seq_num;
+  uint8_t attempts;
+  Address from;
+  Address to;
+  std::string message;
+};
+
+/**
+ * Holds unacknowledged outgoing messages in the order they were sent, indexed
+ * by recipient and sequence number so an acknowledgement can retire its message
+ * without scanning the whole queue.
+ *
+ * Each message has a transmission time held in a timer wheel, so finding the
+ * messages due for (re)transmission only touches those that are due.
+ *
+ * Messages more than kWindowSize ahead of the oldest message to the same
+ * recipient are held back until enough of the earlier ones are acknowledged,
+ * so the recipient's receive window is never overrun.
+ *
+ * Not thread safe, callers must provide their own synchronization.
+ */
+class Outbox {
+ public:
+  typedef std::list<QueuedMessage>::iterator iterator;
+
+  Outbox() {}
+  Outbox(const Outbox&) = delete;
+  Outbox(Outbox&&) = delete;
+  Outbox& operator=(const Outbox&) = delete;
+  Outbox& operator=(Outbox&&) = delete;
+  ~Outbox() {}
+  /**
+   * Appends the given message to the back of the queue, due for transmission
+   * immediately or once the recipient's window allows.
+   */
+  void Push(QueuedMessage message);
+  /**
+   * Returns the position of the message sent to the given address with the
+   * given sequence number, or end() if no such message is queued.
+   */
+  iterator Find(const Address& to, const uint64_t seq_num);
+  /**
+   * Schedules the message at the given position for transmission at the given
+   * time, replacing any previously scheduled time.
+   */
+  void Schedule(iterator it, const std::chrono::system_clock::time_point time);
+  /**
+   * Appends the positions of all messages due for transmission by the given
+   * time.
+   */
+  void Due(const std::chrono::system_clock::time_point now,
+           std::vector<iterator>& due);
+  /**
+   * Returns a time no later than the next scheduled transmission, or nothing
+   * if no transmissions are scheduled.
+   */
+  std::optional<std::chrono::system_clock::time_point> Next() const;
+  /**
+   * Removes the message sent to the given address with the given sequence
+   * number. Returns false if no such message is queued.
+   */
+  bool Acknowledge(const Address& to, const uint64_t seq_num);
+  /**
+   * Removes every message sent to the given address with a sequence number up
+   * to and including cumulative (allowing for wraparound), or
+   * cumulative + 1 + i for each bit i set in
+   * selective, moving them into acknowledged. Returns the number of messages
+   * removed.
+   */
+  size_t Acknowledge(const Address& to, const uint64_t cumulative,
+                     const uint64_t selective,
+                     std::vector<QueuedMessage>& acknowledged);
+  /**
+   * Removes the message at the given position, returning the position of the
+   * next message.
+   */
+  iterator Erase(iterator it);
+  iterator begin() { return messages_.begin(); }
+  iterator end() { return messages_.end(); }
+  bool empty() const { return messages_.empty(); }
+  size_t size() const { return messages_.size(); }
+  /**
+   * Returns the number of messages queued for the given address.
+   */
+  size_t size(const Address& to) const;
+
+ private:
+  struct Entry {
+    iterator message;
+    // Unset until the message has been scheduled
+    std::optional<uint64_t> transmission;
+    // Set while the message is beyond the recipient's window
+    bool held;
+  };
+  typedef std::map<uint64_t, Entry, SequenceLess> Entries;
+  Entry* FindEntry(const Address& to, const uint64_t seq_num);
+  Entries::iterator Erase(Entries& entries, Entries::iterator entry);
+  void Release(Entries& entries);
+  std::list<QueuedMessage> messages_;
+  // Ordered by sequence number so cumulative acknowledgements retire a range
+  std::map<const Address, Entries> index_;
+  // New messages are due immediately, so bypass the timer wheel's resolution
+  std::deque<std::pair<Address, uint64_t>> unscheduled_;
+  TimerWheel<iterator> transmissions_;
+};
+
+#endif  // INCLUDE_WINK_OUTBOX_H_
@@ -0,0 +1,115 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_QUEUE_H_
+#define INCLUDE_WINK_QUEUE_H_
+
+#include <Wink/constants.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * Bounded lock-free queue that any number of threads can push to, and one
+ * thread at a time can pop from.
+ *
+ * Each slot carries a sequence number which tells producers when the slot is
+ * free, and the consumer when it has been filled, so producers only contend on
+ * claiming the next slot.
+ */
+template <typename T>
+class MPSCQueue {
+ public:
+  /**
+   * Creates a queue holding up to capacity values, which must be a power of
+   * two.
+   */
+  explicit MPSCQueue(const size_t capacity = kQueueCapacity)
+      : mask_(capacity - 1), slots_(std::make_unique<Slot[]>(capacity)) {
+    for (size_t i = 0; i < capacity; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  /**
+   * Pushes value onto the queue. Returns false, leaving value untouched, if
+   * the queue is full.
+   */
+  bool TryPush(T& value) {
+    auto position = head_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[position & mask_];
+      const auto sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto difference =
+          static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+      if (difference == 0) {
+        if (head_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = head_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = std::move(value);
+    // Sequentially consistent, so a producer that then finds the consumer
+    // asleep knows the consumer will find this value once woken
+    slot->sequence.store(position + 1, std::memory_order_seq_cst);
+    return true;
+  }
+
+  /**
+   * Pops the oldest value into value. Returns false if the queue is empty.
+   * Must not be called concurrently.
+   */
+  bool TryPop(T& value) {
+    const auto position = tail_.load(std::memory_order_relaxed);
+    auto& slot = slots_[position & mask_];
+    if (slot.sequence.load(std::memory_order_seq_cst) != position + 1) {
+      return false;
+    }
+    value = std::move(slot.value);
+    slot.sequence.store(position + mask_ + 1, std::memory_order_release);
+    tail_.store(position + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * Returns true if the consumer would find nothing to pop.
+   */
+  bool empty() const {
+    const auto position = tail_.load(std::memory_order_relaxed);
+    return slots_[position & mask_].sequence.load(std::memory_order_seq_cst) !=
+           position + 1;
+  }
+
+  /**
+   * Returns the number of values pushed and not yet popped, which may be
+   * stale by the time it is used.
+   */
+  size_t size() const {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    const auto head = head_.load(std::memory_order_relaxed);
+    return head > tail ? head - tail : 0;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  // Kept on separate cache lines, so producers and the consumer don't slow
+  // each other down
+  alignas(64) std::atomic<size_t> head_ = 0;
+  alignas(64) std::atomic<size_t> tail_ = 0;
+};
+
+#endif  // INCLUDE_WINK_QUEUE_H_
@@ -0,0 +1,71 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_RESOLVER_H_
+#define INCLUDE_WINK_RESOLVER_H_
+
+#include <Wink/constants.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Caches the IP addresses of hostnames, so each is resolved once and then
+ * refreshed in the background. Only the first lookup of a hostname waits for
+ * it to resolve, later lookups return the cached IP even once it has expired,
+ * while the refresh is under way.
+ *
+ * Failed lookups aren't cached, so the next lookup tries again, and a failed
+ * refresh keeps the previous IP until the next one.
+ */
+class Resolver {
+ public:
+  /**
+   * Creates a resolver caching the results of resolve for ttl. Hostnames that
+   * aren't looked up for a whole ttl are forgotten rather than refreshed.
+   */
+  explicit Resolver(
+      const std::chrono::milliseconds ttl = kResolveTTL,
+      std::function<std::string(const std::string&)> resolve = nullptr);
+  Resolver(const Resolver&) = delete;
+  Resolver(Resolver&&) = delete;
+  Resolver& operator=(const Resolver&) = delete;
+  Resolver& operator=(Resolver&&) = delete;
+  ~Resolver();
+  /**
+   * Returns the resolver shared by the whole process.
+   */
+  static Resolver& Instance();
+  /**
+   * Returns the IP address of the given hostname, or the hostname itself if
+   * it couldn't be resolved.
+   */
+  std::string Resolve(const std::string& hostname);
+  /**
+   * Returns the number of hostnames cached.
+   */
+  size_t size();
+
+ private:
+  void BackgroundRefresh();
+  const std::chrono::milliseconds ttl_;
+  const std::function<std::string(const std::string&)> resolve_;
+  struct Entry {
+    std::string ip;
+    std::chrono::steady_clock::time_point expiry;
+    bool used;
+  };
+  std::map<std::string, Entry> entries_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool running_ = true;
+  // Started on the first lookup, so processes that only use IP addresses
+  // don't pay for it
+  std::thread refresher_;
+};
+
+#endif  // INCLUDE_WINK_RESOLVER_H_
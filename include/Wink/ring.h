@@ -0,0 +1,85 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_RING_H_
+#define INCLUDE_WINK_RING_H_
+
+#include <Wink/address.h>
+#include <Wink/socket.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Ring buffer of datagrams in named shared memory, through which processes on
+ * the same host can send datagrams to the ring's owner without a system call.
+ *
+ * Any number of processes may push into a ring, but only its owner may pop
+ * from it.
+ */
+class SharedMemoryRing {
+ public:
+  /**
+   * Creates and owns the ring with the given name, replacing any left behind
+   * by a previous owner.
+   */
+  explicit SharedMemoryRing(const std::string& name);
+  SharedMemoryRing(const SharedMemoryRing&) = delete;
+  SharedMemoryRing(SharedMemoryRing&&) = delete;
+  SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+  SharedMemoryRing& operator=(SharedMemoryRing&&) = delete;
+  ~SharedMemoryRing();
+  /**
+   * Opens the ring with the given name owned by another socket, returning
+   * nullptr if no such ring exists. A ring whose owner died without closing it
+   * is removed instead.
+   */
+  static std::unique_ptr<SharedMemoryRing> Open(const std::string& name);
+  /**
+   * Appends a datagram of up to kMaxUDPPayload bytes to the ring. Returns false
+   * if the datagram is too long, the ring is full, or its owner has closed it.
+   */
+  bool Push(const Address& from, const char* buffer, const size_t length);
+  /**
+   * Removes up to datagrams.size() datagrams from the ring, each into a buffer
+   * of at least kMaxUDPPayload bytes. Returns the number of datagrams removed.
+   * A corrupt record closes the ring, and is discarded along with everything
+   * after it.
+   */
+  size_t Pop(std::vector<Datagram>& datagrams, const Address& to);
+  bool empty() const;
+  /**
+   * Returns true if the owner has closed the ring, after which it should be
+   * reopened.
+   */
+  bool closed() const;
+  /**
+   * Returns true if the ring is open and its owner is still running, closing
+   * the ring if the owner died without closing it. Unlike closed(), this makes
+   * a system call.
+   */
+  bool alive();
+  /**
+   * Marks the owner as about to sleep until woken. Returns false, and doesn't
+   * mark the owner, if the ring is not empty.
+   */
+  bool Sleep();
+  /**
+   * Marks the owner as awake.
+   */
+  void Awake();
+  /**
+   * Returns true if the owner is sleeping and should be woken, only once per
+   * sleep.
+   */
+  bool Wake();
+
+ private:
+  struct Header;
+  SharedMemoryRing(const std::string& name, Header* header);
+  const std::string name_;
+  const bool owner_;
+  Header* header_;
+  char* data_;
+};
+
+#endif  // INCLUDE_WINK_RING_H_
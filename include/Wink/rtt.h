@@ -0,0 +1,41 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_RTT_H_
+#define INCLUDE_WINK_RTT_H_
+
+#include <Wink/constants.h>
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Round Trip Time statistics of a peer.
+ *
+ * The smoothed round trip time and its variance are estimated from
+ * acknowledgements as per RFC 6298, and used to derive the timeout after which
+ * an unacknowledged message is retransmitted.
+ */
+class RoundTrip {
+ public:
+  /**
+   * Updates the estimate with a measured round trip time. Only messages that
+   * were transmitted once should be measured, as it is ambiguous which
+   * transmission a retransmitted message's acknowledgement is for.
+   */
+  void Sample(const std::chrono::microseconds rtt);
+  /**
+   * Returns the timeout to wait for an acknowledgement after the given number
+   * of transmissions, doubling with each retransmission.
+   */
+  std::chrono::microseconds Timeout(const uint8_t attempts = 1) const;
+  std::chrono::microseconds smoothed() const { return smoothed_; }
+  std::chrono::microseconds variance() const { return variance_; }
+  uint64_t samples() const { return samples_; }
+
+ private:
+  std::chrono::microseconds smoothed_ = std::chrono::microseconds(0);
+  std::chrono::microseconds variance_ = std::chrono::microseconds(0);
+  std::chrono::microseconds timeout_ = kInitialRetransmitTimeout;
+  uint64_t samples_ = 0;
+};
+
+#endif  // INCLUDE_WINK_RTT_H_
@@ -0,0 +1,26 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_SEQUENCE_H_
+#define INCLUDE_WINK_SEQUENCE_H_
+
+#include <cstdint>
+
+/**
+ * Returns true if sequence number a comes before b, allowing for the sequence
+ * wrapping around (RFC 1982). Sequence numbers compare correctly as long as
+ * they are within 2^63 of each other.
+ */
+inline bool SequenceBefore(const uint64_t a, const uint64_t b) {
+  return static_cast<int64_t>(a - b) < 0;
+}
+
+/**
+ * Orders sequence numbers allowing for wraparound, for use as the comparator
+ * of ordered containers.
+ */
+struct SequenceLess {
+  bool operator()(const uint64_t a, const uint64_t b) const {
+    return SequenceBefore(a, b);
+  }
+};
+
+#endif  // INCLUDE_WINK_SEQUENCE_H_
@@ -7,8 +7,37 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
+
+class IOUring;
+class SharedMemoryRing;
+
+struct Datagram {
+  Address from;
+  Address to;
+  char* buffer = nullptr;
+  size_t length = 0;
+};
+
+/**
+ * Outcome of sending a datagram to a peer through a transport local to the
+ * host.
+ */
+enum class Delivery {
+  kSent,
+  // Peer can't take the datagram yet, so it should be sent again later
+  kBusy,
+  // Peer can no longer be reached reliably, so it should be sent over the
+  // network instead
+  kUnreachable,
+};
 
 class Socket {
  public:
@@ -16,13 +45,62 @@ class Socket {
   virtual bool Receive(Address&, Address&, char*, size_t&) = 0;
   virtual bool ReceiveMulticast(Address&, Address&, char*, size_t&) = 0;
   virtual bool Send(const Address&, const char*, const size_t) = 0;
+  /**
+   * Receives up to datagrams.size() unicast or multicast datagrams, each into a
+   * buffer of at least kMaxUDPPayload bytes. Returns the number of datagrams
+   * received.
+   */
+  virtual size_t ReceiveBatch(std::vector<Datagram>& datagrams);
+  /**
+   * Sends the first count datagrams. Returns the number of datagrams sent.
+   */
+  virtual size_t SendBatch(const std::vector<Datagram>& datagrams,
+                           const size_t count);
+  /**
+   * Returns the number of shards datagrams are received on, each of which can
+   * be received from concurrently.
+   */
+  virtual size_t Shards() { return 1; }
+  /**
+   * Receives as ReceiveBatch, but only the datagrams arriving on the given
+   * shard. Multicast datagrams arrive on the first shard.
+   */
+  virtual size_t ReceiveShard(std::vector<Datagram>& datagrams,
+                              const size_t shard);
+  /**
+   * Returns true if datagrams sent to the given address are delivered reliably
+   * and in order, so need not be acknowledged.
+   */
+  virtual bool Reliable(const Address&) { return false; }
+  /**
+   * Sends the datagram to an address that is Reliable, without waiting for the
+   * peer to make room for it.
+   */
+  virtual Delivery SendReliable(const Address& to, const char* buffer,
+                                const size_t length) {
+    return Send(to, buffer, length) ? Delivery::kSent : Delivery::kUnreachable;
+  }
+  /**
+   * Returns true if the given address is this socket's own, so datagrams sent
+   * to it would come straight back.
+   */
+  virtual bool Self(const Address&) { return false; }
 };
 
 class UDPSocket : public Socket {
  public:
-  explicit UDPSocket(Address& address);
+  /**
+   * Binds to the given address, updating it with the port assigned. If shards
+   * is greater than one, that many sockets share the address and the kernel
+   * spreads incoming datagrams across them, keeping each peer on one shard.
+   */
+  explicit UDPSocket(Address& address, const size_t shards = 1);
   ~UDPSocket() {
+    close(epoll_);
     close(unicast_socket_);
+    for (auto s : shard_sockets_) {
+      close(s);
+    }
     for (auto& [a, s] : multicast_sockets_) {
       close(s);
     }
@@ -30,14 +108,151 @@ class UDPSocket : public Socket {
   bool Receive(Address&, Address&, char*, size_t&) override;
   bool ReceiveMulticast(Address&, Address&, char*, size_t&) override;
   bool Send(const Address&, const char*, const size_t) override;
+  size_t ReceiveBatch(std::vector<Datagram>& datagrams) override;
+  size_t SendBatch(const std::vector<Datagram>& datagrams,
+                   const size_t count) override;
+  bool Self(const Address& to) override;
+  size_t Shards() override;
+  size_t ReceiveShard(std::vector<Datagram>& datagrams,
+                      const size_t shard) override;
   bool JoinGroup(const Address&);
   bool LeaveGroup(const Address&);
 
- private:
+ protected:
+  /**
+   * Receives as ReceiveBatch(datagrams), waiting no longer than the given
+   * timeout for datagrams to arrive.
+   */
+  size_t ReceiveBatch(std::vector<Datagram>& datagrams,
+                      const std::chrono::milliseconds timeout);
+  /**
+   * Wakes ReceiveBatch when the given socket has datagrams, which are left for
+   * the caller to receive.
+   */
+  bool Watch(const int socket);
+  /**
+   * Stops waking ReceiveBatch for the given socket.
+   */
+  bool Unwatch(const int socket);
   Address& address_;
   int unicast_socket_ = -1;
+
+ private:
+  size_t ReceiveSegments(const size_t shard, std::vector<Datagram>& datagrams);
+  size_t ReceiveBatch(const int socket, const size_t shard, const Address& to,
+                      std::vector<Datagram>& datagrams, const size_t offset);
+  int epoll_ = -1;
+  // Sockets sharing the unicast address, one for each shard after the first
+  std::vector<int> shard_sockets_;
   std::map<Address, int> multicast_sockets_;
+  std::map<int, Address> multicast_groups_;
+  std::mutex multicast_mutex_;
   std::mutex send_mutex_;
+  // Segments of coalesced datagrams that didn't fit in the last batch, kept for
+  // each shard so they're delivered by the thread receiving from it
+  struct Segment {
+    Address from;
+    Address to;
+    std::string payload;
+  };
+  std::vector<std::deque<Segment>> segments_;
+  std::mutex segments_mutex_;
+  // Cleared if the kernel or network card can't segment datagrams
+  std::atomic_bool segmentation_ = true;
+};
+
+/**
+ * UDP socket that sends to and receives from other SharedMemorySockets on the
+ * same host through shared memory rings, falling back to UDP for everyone
+ * else. Sends to a peer whose ring is full fail, rather than overtake the
+ * datagrams in it over UDP.
+ */
+class SharedMemorySocket : public UDPSocket {
+ public:
+  explicit SharedMemorySocket(Address& address);
+  ~SharedMemorySocket();
+  bool Receive(Address&, Address&, char*, size_t&) override;
+  bool Send(const Address&, const char*, const size_t) override;
+  size_t ReceiveBatch(std::vector<Datagram>& datagrams) override;
+  size_t SendBatch(const std::vector<Datagram>& datagrams,
+                   const size_t count) override;
+
+ private:
+  Delivery SendRing(const Address& to, const char* buffer,
+                    const size_t length);
+  std::unique_ptr<SharedMemoryRing> inbox_;
+  struct Peer {
+    std::unique_ptr<SharedMemoryRing> ring;
+    // When to next look for the peer's ring if it has none, or check its owner
+    // is still running if it has
+    std::chrono::steady_clock::time_point retry;
+  };
+  std::map<Address, Peer> peers_;
+  std::mutex peers_mutex_;
+};
+
+/**
+ * UDP socket that sends to and receives from other UnixSockets on the same
+ * host through Unix domain datagram sockets, falling back to UDP for everyone
+ * else. Unix domain datagrams are neither lost nor reordered, so peers reached
+ * through them are Reliable.
+ */
+class UnixSocket : public UDPSocket {
+ public:
+  explicit UnixSocket(Address& address);
+  ~UnixSocket();
+  bool Receive(Address&, Address&, char*, size_t&) override;
+  bool Send(const Address&, const char*, const size_t) override;
+  size_t ReceiveBatch(std::vector<Datagram>& datagrams) override;
+  size_t SendBatch(const std::vector<Datagram>& datagrams,
+                   const size_t count) override;
+  bool Reliable(const Address& to) override;
+  Delivery SendReliable(const Address& to, const char* buffer,
+                        const size_t length) override;
+
+ private:
+  size_t ReceiveLocal(std::vector<Datagram>& datagrams);
+  Delivery SendLocal(const Address& to, const char* buffer,
+                     const size_t length);
+  const std::string path_;
+  int local_socket_ = -1;
+  // Whether each peer has a Unix socket, decided on first contact, and again
+  // if a send to it fails
+  std::map<Address, bool> peers_;
+  std::mutex peers_mutex_;
+};
+
+/**
+ * UDP socket that receives unicast datagrams through a multishot receive into
+ * buffers provided to the kernel, and sends batches of datagrams as linked
+ * submissions, through io_uring. Behaves as a UDPSocket if the kernel doesn't
+ * support io_uring.
+ */
+class IOUringSocket : public UDPSocket {
+ public:
+  explicit IOUringSocket(Address& address);
+  ~IOUringSocket();
+  bool Receive(Address&, Address&, char*, size_t&) override;
+  size_t ReceiveBatch(std::vector<Datagram>& datagrams) override;
+  size_t SendBatch(const std::vector<Datagram>& datagrams,
+                   const size_t count) override;
+  /**
+   * Returns true if io_uring is in use, false if the socket fell back to
+   * UDPSocket.
+   */
+  bool enabled();
+
+ private:
+  bool Arm();
+  void Disable();
+  size_t Complete(std::vector<Datagram>& datagrams);
+  // Declared before the rings so they outlive any receive in flight
+  std::vector<char> receive_buffers_;
+  msghdr receive_header_ = {};
+  std::unique_ptr<IOUring> receive_ring_;
+  std::unique_ptr<IOUring> send_ring_;
+  std::mutex receive_mutex_;
+  std::mutex send_ring_mutex_;
 };
 
 #endif  // INCLUDE_WINK_SOCKET_H_
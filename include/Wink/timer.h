@@ -0,0 +1,212 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_TIMER_H_
+#define INCLUDE_WINK_TIMER_H_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Hierarchical Timer Wheel.
+ *
+ * Timers are bucketed by deadline into kLevels wheels of kSlots slots, each
+ * level covering kSlots times the span of the level below it. Advancing the
+ * wheel only visits the slots of the ticks that have elapsed, and timers in
+ * higher levels are cascaded down as their slot comes due, so the cost of a
+ * tick is proportional to the number of timers that expire rather than the
+ * number that are scheduled.
+ *
+ * Deadlines are rounded up to a whole Tick, so finer ticks fire timers closer
+ * to their deadline, at the cost of a shorter span in each level.
+ *
+ * Not thread safe, callers must provide their own synchronization.
+ */
+template <typename T, typename Tick = std::chrono::milliseconds>
+class TimerWheel {
+ public:
+  typedef std::chrono::system_clock::time_point time_point;
+  typedef Tick tick;
+
+  static constexpr uint64_t kSlotBits = 6;
+  static constexpr uint64_t kSlots = 1 << kSlotBits;
+  static constexpr uint64_t kLevels = 4;
+  // Timers further out than this are held in the top level until they're near
+  static constexpr uint64_t kMaxTicks = uint64_t(1) << (kSlotBits * kLevels);
+
+  explicit TimerWheel(
+      const time_point origin = std::chrono::system_clock::now())
+      : origin_(origin) {}
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel(TimerWheel&&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+  TimerWheel& operator=(TimerWheel&&) = delete;
+  ~TimerWheel() {}
+
+  /**
+   * Schedules the value to expire at the deadline, returning an identifier
+   * which can be used to cancel it. Deadlines which have already passed
+   * expire on the next tick.
+   */
+  uint64_t Schedule(const time_point deadline, T value) {
+    const auto id = next_id_++;
+    const auto expiry = std::max(ToTick(deadline), now_ + 1);
+    Insert(Entry{id, expiry, 0, 0, std::move(value)});
+    return id;
+  }
+
+  /**
+   * Cancels the timer with the given identifier. Returns false if the timer
+   * has already expired or been cancelled.
+   */
+  bool Cancel(const uint64_t id) {
+    const auto it = index_.find(id);
+    if (it == index_.end()) {
+      return false;
+    }
+    const auto entry = it->second;
+    slots_[entry->level][entry->slot].erase(entry);
+    index_.erase(it);
+    return true;
+  }
+
+  /**
+   * Advances the wheel to the given time, appending the values of all expired
+   * timers to expired in order of deadline.
+   */
+  void Advance(const time_point time, std::vector<T>& expired) {
+    const auto target = ToTick(time, false);
+    while (now_ < target) {
+      // Skip ahead over ticks with nothing to cascade or expire
+      const auto t = NextTick();
+      if (t > target) {
+        now_ = target;
+        break;
+      }
+      now_ = t;
+
+      // Cascade timers from higher levels whose slot has come due
+      for (uint64_t level = 1; level < kLevels; level++) {
+        if ((t & Mask(level - 1)) != 0) {
+          break;
+        }
+        auto& slot = slots_[level][Slot(t, level)];
+        std::list<Entry> cascade;
+        cascade.swap(slot);
+        while (!cascade.empty()) {
+          Insert(cascade, cascade.begin());
+        }
+      }
+
+      // Expire timers due this tick
+      auto& slot = slots_[0][Slot(t, 0)];
+      while (!slot.empty()) {
+        auto& entry = slot.front();
+        index_.erase(entry.id);
+        expired.push_back(std::move(entry.value));
+        slot.pop_front();
+      }
+    }
+  }
+
+  /**
+   * Returns a time no later than the earliest deadline of all scheduled
+   * timers, or nothing if there are none.
+   */
+  std::optional<time_point> Next() const {
+    if (index_.empty()) {
+      return std::nullopt;
+    }
+    return ToTime(NextTick());
+  }
+
+  size_t size() const { return index_.size(); }
+  bool empty() const { return index_.empty(); }
+
+ private:
+  struct Entry {
+    uint64_t id;
+    uint64_t expiry;
+    uint64_t level;
+    uint64_t slot;
+    T value;
+  };
+
+  static constexpr uint64_t Mask(const uint64_t level) {
+    return (uint64_t(1) << (kSlotBits * (level + 1))) - 1;
+  }
+
+  static constexpr uint64_t Slot(const uint64_t t, const uint64_t level) {
+    return (t >> (kSlotBits * level)) & (kSlots - 1);
+  }
+
+  // Deadlines round up and the current time rounds down, so timers never
+  // expire early.
+  uint64_t ToTick(const time_point time, const bool round_up = true) const {
+    if (time <= origin_) {
+      return 0;
+    }
+    if (round_up) {
+      return std::chrono::ceil<tick>(time - origin_).count();
+    }
+    return std::chrono::floor<tick>(time - origin_).count();
+  }
+
+  time_point ToTime(const uint64_t t) const { return origin_ + tick(t); }
+
+  // Returns the first tick after now_ at which a non-empty slot is cascaded or
+  // expired.
+  uint64_t NextTick() const {
+    uint64_t next = UINT64_MAX;
+    for (uint64_t level = 0; level < kLevels; level++) {
+      const auto shift = kSlotBits * level;
+      const auto base = now_ >> shift;
+      for (uint64_t i = 1; i <= kSlots; i++) {
+        if (!slots_[level][(base + i) & (kSlots - 1)].empty()) {
+          next = std::min(next, (base + i) << shift);
+          break;
+        }
+      }
+    }
+    return next;
+  }
+
+  // Places the entry in the level whose span covers its remaining time.
+  void Place(Entry& entry) {
+    const auto expiry = std::min(entry.expiry, now_ + kMaxTicks - 1);
+    const auto delta = expiry - now_;
+    uint64_t level = 0;
+    while (level < kLevels - 1 && delta > Mask(level)) {
+      level++;
+    }
+    entry.level = level;
+    entry.slot = Slot(expiry, level);
+  }
+
+  void Insert(Entry entry) {
+    std::list<Entry> node;
+    node.push_back(std::move(entry));
+    Insert(node, node.begin());
+  }
+
+  // Moves the node into its slot, keeping iterators in index_ valid.
+  void Insert(std::list<Entry>& from, typename std::list<Entry>::iterator it) {
+    Place(*it);
+    auto& slot = slots_[it->level][it->slot];
+    slot.splice(slot.end(), from, it);
+    index_[it->id] = it;
+  }
+
+  const time_point origin_;
+  uint64_t now_ = 0;
+  uint64_t next_id_ = 0;
+  std::array<std::array<std::list<Entry>, kSlots>, kLevels> slots_;
+  std::unordered_map<uint64_t, typename std::list<Entry>::iterator> index_;
+};
+
+#endif  // INCLUDE_WINK_TIMER_H_
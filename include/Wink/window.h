@@ -0,0 +1,50 @@
+// Copyright 2022-2025 Stuart Scott
+#ifndef INCLUDE_WINK_WINDOW_H_
+#define INCLUDE_WINK_WINDOW_H_
+
+#include <cstdint>
+
+// Number of sequence numbers a window can track beyond its cumulative sequence
+// number, and so the most messages that may be unacknowledged at once
+constexpr uint64_t kWindowSize = 64;
+
+/**
+ * Tracks the sequence numbers received from a peer, as a cumulative sequence
+ * number below which everything has been received, and a bitmap of the
+ * sequence numbers received beyond it.
+ *
+ * A window starts from zero if the first sequence number received is within
+ * reach of it, so messages overtaken by the first are still received,
+ * otherwise the first sequence number received starts the window and anything
+ * before it is treated as already received. Sequence numbers may wrap around.
+ */
+class ReceiveWindow {
+ public:
+  /**
+   * Records the receipt of the given sequence number. Returns false if it has
+   * already been received.
+   */
+  bool Receive(const uint64_t seq_num);
+  /**
+   * Gives up on any sequence numbers before the given one that have not been
+   * received, treating them as received.
+   */
+  void Skip(const uint64_t seq_num);
+  /**
+   * Returns the sequence number up to and including which everything has been
+   * received.
+   */
+  uint64_t cumulative() const { return cumulative_; }
+  /**
+   * Returns a bitmap where bit i is set if cumulative() + 1 + i has been
+   * received.
+   */
+  uint64_t selective() const { return selective_; }
+
+ private:
+  bool started_ = false;
+  uint64_t cumulative_ = 0;
+  uint64_t selective_ = 0;
+};
+
+#endif  // INCLUDE_WINK_WINDOW_H_
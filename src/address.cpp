@@ -1,8 +1,10 @@
 // Copyright 2022-2025 Stuart Scott
 #include <Wink/address.h>
+#include <Wink/resolver.h>
 
 #include <cctype>
 #include <cstring>
+#include <stdexcept>
 #include <string>
 
 std::string Resolve(const std::string ip) {
@@ -57,41 +59,30 @@ void Address::FromString(const std::string& address) {
 
 std::string Address::ToString() const {
   std::ostringstream oss;
-  oss << ip_;
-  oss << ':';
-  oss << port_;
+  oss << *this;
   return oss.str();
 }
 
-uint32_t Address::ToInetAddr() const {
-  auto c = ip_.c_str();
-  if (!isdigit(c[0])) {
-    if (const auto record = gethostbyname(c); record) {
-      in_addr* ia = reinterpret_cast<in_addr*>(record->h_addr);
-      c = inet_ntoa(*ia);
-    }
+void Address::set_ip(std::string ip) {
+  if (ip.empty()) {
+    ip_ = INADDR_ANY;
+    return;
   }
-  return inet_addr(c);
-}
-
-bool Address::IsMulticast() const {
-  // InetAddr is in network byte order
-  unsigned char first_octet = ToInetAddr() & 0xFF;
-  return (first_octet >= 224 && first_octet <= 239);
-}
-
-void Address::ReadFrom(const struct sockaddr_in& address) {
-  set_ip(inet_ntoa(address.sin_addr));
-  set_port(ntohs(address.sin_port));
+  in_addr address;
+  if (inet_pton(AF_INET, ip.c_str(), &address) != 1 &&
+      inet_pton(AF_INET, Resolver::Instance().Resolve(ip).c_str(),
+                &address) != 1) {
+    throw std::invalid_argument("Failed to resolve " + ip);
+  }
+  ip_ = address.s_addr;
 }
 
-void Address::WriteTo(struct sockaddr_in& address) const {
-  memset(&address, 0, sizeof(struct sockaddr_in));
-  address.sin_family = AF_INET;
-  if (!ip_.empty()) {
-    address.sin_addr.s_addr = ToInetAddr();
-  }
-  address.sin_port = htons(port_);
+std::string Address::ip() const {
+  in_addr address;
+  address.s_addr = ip_;
+  char ip[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &address, ip, INET_ADDRSTRLEN);
+  return ip;
 }
 
 std::istream& operator>>(std::istream& is, Address& address) {
@@ -1,213 +1,881 @@
 // Copyright 2022-2025 Stuart Scott
+#include <Wink/header.h>
 #include <Wink/log.h>
 #include <Wink/mailbox.h>
 #include <Wink/socket.h>
+#include <endian.h>
 
 #include <algorithm>
 #include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <iterator>
+#include <optional>
+#include <set>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
-AsyncMailbox::AsyncMailbox(Socket& socket)
+// Acknowledgements carry the cumulative sequence number in their header, and
+// the selective bitmap if any messages beyond it have been received
+constexpr size_t kSelectiveAckLength = kHeaderLength + sizeof(uint64_t);
+
+// Writes an acknowledgement of the given lane's window to buffer, which must
+// have room for kSelectiveAckLength bytes, returning its length
+size_t WriteAck(char* buffer, const size_t lane, const ReceiveWindow& window) {
+  Header header;
+  header.type = MessageType::kAck;
+  header.lane = lane;
+  header.seq_num = window.cumulative();
+  if (const uint64_t selective = window.selective(); selective != 0) {
+    header.length = sizeof(uint64_t);
+    const uint64_t s = htobe64(selective);
+    std::memcpy(buffer + kHeaderLength, &s, sizeof(uint64_t));
+  }
+  header.WriteTo(buffer);
+  return kHeaderLength + header.length;
+}
+
+// Appends the given message to buffer, with a header of the given type
+void WriteMessage(std::string& buffer, const MessageType type,
+                  const size_t lane, const uint64_t seq_num,
+                  const std::string& message) {
+  Header header;
+  header.type = type;
+  header.lane = lane;
+  header.length = std::min(message.length(), kMaxUDPPayload - kHeaderLength);
+  header.seq_num = seq_num;
+  const auto offset = buffer.length();
+  buffer.resize(offset + kHeaderLength);
+  header.WriteTo(buffer.data() + offset);
+  buffer.append(message, 0, header.length);
+}
+
+// Returns the length of the message without its trailing newlines, which
+// aren't part of it
+size_t TrimmedLength(const char* message, size_t length) {
+  while (length > 0 && message[length - 1] == '\n') {
+    --length;
+  }
+  return length;
+}
+
+AsyncMailbox::AsyncMailbox(Socket& socket, const bool ordered,
+                           const size_t peer_limit, const size_t limit)
     : socket_(socket),
+      ordered_(ordered),
+      peer_limit_(peer_limit),
+      limit_(limit),
+      ack_buffers_(kMaxBatchSize * kSelectiveAckLength),
+      acks_(kMaxBatchSize),
+      send_buffers_(kMaxBatchSize),
+      sends_(kMaxBatchSize),
+      random_(std::random_device()()),
       running_(true),
-      receiver_([&]() {
-        while (running_) {
-          BackgroundReceive();
-          BackgroundReceiveMulticast();
-        }
-      }),
       sender_([&]() {
         while (running_) {
           BackgroundSend();
-          BackgroundSendMulticast();
         }
-      }) {}
+      }) {
+  for (size_t shard = 0; shard < socket_.Shards(); shard++) {
+    receivers_.emplace_back([this, shard]() {
+      std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+      std::vector<Datagram> datagrams(kMaxBatchSize);
+      while (running_) {
+        BackgroundReceive(shard, buffers, datagrams);
+      }
+    });
+  }
+}
 
 AsyncMailbox::~AsyncMailbox() {
   while (!Flushed()) {
   }
-  running_ = false;
-  receiver_.join();
+  {
+    std::scoped_lock lock(outgoing_mutex_);
+    running_ = false;
+  }
+  {
+    std::scoped_lock lock(incoming_mutex_);
+    room_condition_.notify_all();
+  }
+  sender_condition_.notify_all();
+  outgoing_condition_.notify_all();
+  for (auto& receiver : receivers_) {
+    receiver.join();
+  }
   sender_.join();
 }
 
 bool AsyncMailbox::Receive(Address& from, Address& to, std::string& message) {
+  return Receive(from, to, message,
+                 std::chrono::system_clock::now() + kReceiveTimeout);
+}
+
+bool AsyncMailbox::Receive(
+    Address& from, Address& to, std::string& message,
+    const std::chrono::system_clock::time_point deadline) {
   std::unique_lock lock(incoming_mutex_);
-  if (!incoming_condition_.wait_for(lock, kReceiveTimeout, [this] {
-        return !incoming_messages_.empty();
-      })) {
+  QueuedMessage in;
+  if (!AwaitPop(lock, in, deadline)) {
     return false;
   }
-
-  const auto& in = incoming_messages_.front();
   from = in.from;
   to = in.to;
-  message = in.message;
-  incoming_messages_.pop_front();
+  message = std::move(in.message);
   return true;
 }
 
-void AsyncMailbox::Send(const Address& to, const std::string& message) {
-  std::scoped_lock lock(outgoing_mutex_);
-  if (to.IsMulticast()) {
-    outgoing_multicasts_.emplace_back(std::chrono::system_clock::now(), 0, 0,
-                                      Address(), to, message);
-  } else {
-    uint64_t seq_num = 0;
-    if (const auto& it = outgoing_seq_nums_.find(to);
-        it != outgoing_seq_nums_.end()) {
-      seq_num = ++(it->second);
-    } else {
-      outgoing_seq_nums_[to] = 0;
+size_t AsyncMailbox::ReceiveBatch(
+    std::vector<ReceivedMessage>& messages, const size_t max,
+    const std::chrono::system_clock::time_point deadline) {
+  messages.clear();
+  if (max == 0) {
+    return 0;
+  }
+  std::unique_lock lock(incoming_mutex_);
+  QueuedMessage in;
+  if (!AwaitPop(lock, in, deadline)) {
+    return 0;
+  }
+  do {
+    messages.emplace_back(in.from, in.to, std::move(in.message));
+  } while (messages.size() < max && Pop(in));
+  return messages.size();
+}
+
+bool AsyncMailbox::Pop(QueuedMessage& message) {
+  // Deliver higher lanes first
+  for (auto lane = kPriorities; lane-- > 0;) {
+    if (incoming_messages_[lane].TryPop(message)) {
+      if (deliverers_waiting_ > 0) {
+        room_condition_.notify_all();
+      }
+      return true;
+    }
+    if (auto& self = incoming_self_[lane]; !self.empty()) {
+      message = std::move(self.front());
+      self.pop_front();
+      return true;
     }
-    outgoing_messages_.emplace_back(std::chrono::system_clock::now(), seq_num,
-                                    0, Address(), to, message);
   }
-  outgoing_condition_.notify_all();
+  return false;
+}
+
+bool AsyncMailbox::AwaitPop(
+    std::unique_lock<std::mutex>& lock, QueuedMessage& message,
+    const std::chrono::system_clock::time_point deadline) {
+  if (Pop(message)) {
+    return true;
+  }
+  // Receivers notify only while someone is waiting, so count ourselves before
+  // looking again
+  receivers_waiting_++;
+  const bool popped = incoming_condition_.wait_until(
+      lock, deadline, [&] { return Pop(message); });
+  receivers_waiting_--;
+  return popped;
+}
+
+void AsyncMailbox::Send(const Address& to, const std::string& message,
+                        const Priority priority) {
+  if (socket_.Self(to)) {
+    Deliver(to, message, priority);
+    return;
+  }
+  if (Submit(to, message, priority)) {
+    return;
+  }
+  std::unique_lock lock(outgoing_mutex_);
+  Drain();
+  outgoing_condition_.wait(lock, [&] { return Room(to, priority); });
+  Queue(to, message, priority);
+}
+
+bool AsyncMailbox::TrySend(
+    const Address& to, const std::string& message,
+    const std::chrono::system_clock::time_point deadline) {
+  if (socket_.Self(to)) {
+    Deliver(to, message, Priority::kNormal);
+    return true;
+  }
+  if (Submit(to, message, Priority::kNormal)) {
+    return true;
+  }
+  std::unique_lock lock(outgoing_mutex_);
+  Drain();
+  if (!outgoing_condition_.wait_until(
+          lock, deadline, [&] { return Room(to, Priority::kNormal); })) {
+    return false;
+  }
+  Queue(to, message, Priority::kNormal);
+  return true;
 }
 
 bool AsyncMailbox::Flushed() {
   std::unique_lock lock(outgoing_mutex_);
   return outgoing_condition_.wait_for(lock, kSendTimeout, [this] {
-    return outgoing_messages_.empty() && outgoing_multicasts_.empty();
+    if (!submissions_.empty()) {
+      return false;
+    }
+    for (size_t lane = 0; lane < kPriorities; lane++) {
+      if (!outgoing_messages_[lane].empty() ||
+          !outgoing_unacknowledged_[lane].empty() ||
+          !pending_acks_[lane].empty()) {
+        return false;
+      }
+    }
+    return true;
   });
 }
 
-void AsyncMailbox::BackgroundReceive() {
-  Address from;
-  Address to;
-  size_t length;
-  if (!socket_.Receive(from, to, receive_buffer_, length)) {
-    return;
+std::map<Address, RoundTrip> AsyncMailbox::RoundTrips() {
+  std::scoped_lock lock(outgoing_mutex_);
+  return std::map<Address, RoundTrip>(round_trips_.begin(),
+                                      round_trips_.end());
+}
+
+void AsyncMailbox::SetPackBudget(const size_t size,
+                                 const std::chrono::microseconds delay) {
+  std::scoped_lock lock(outgoing_mutex_);
+  pack_size_ = std::min(size, kMaxUDPPayload);
+  pack_delay_ = delay;
+}
+
+void AsyncMailbox::SetPacking(const Address& peer, const bool packing) {
+  std::scoped_lock lock(outgoing_mutex_);
+  if (packing) {
+    unpacked_.erase(peer);
+  } else {
+    unpacked_.insert(peer);
   }
-  while (receive_buffer_[length - 1] == '\n') {
-    --length;
+}
+
+size_t AsyncMailbox::Outgoing() const {
+  size_t total = 0;
+  for (size_t lane = 0; lane < kPriorities; lane++) {
+    total += outgoing_messages_[lane].size() +
+             outgoing_unacknowledged_[lane].size();
   }
-  if (length < sizeof(uint64_t)) {
-    Error() << "Message too small: " << length << std::endl;
-    return;
+  return total;
+}
+
+bool AsyncMailbox::Room(const Address& to, const Priority priority) const {
+  // Control messages are few, and mustn't wait behind bulk traffic
+  if (priority != Priority::kNormal) {
+    return true;
+  }
+  if (Outgoing() >= limit_) {
+    return false;
   }
+  // Messages that aren't acknowledged leave with the next batch, so only the
+  // total limits them
+  const auto& outgoing = outgoing_messages_[static_cast<size_t>(priority)];
+  return to.IsMulticast() || outgoing.size(to) < peer_limit_;
+}
 
-  // Parse sequence number
-  uint64_t seq_num;
-  std::memcpy(&seq_num, receive_buffer_, sizeof(uint64_t));
+bool AsyncMailbox::Submit(const Address& to, const std::string& message,
+                          const Priority priority) {
+  // Far enough from the limits that no peer can be at its own, otherwise
+  // leave the caller to wait for room under the lock. Messages that aren't
+  // acknowledged are only limited by the total
+  if (priority == Priority::kNormal) {
+    const auto limit = to.IsMulticast() || socket_.Reliable(to)
+                           ? limit_
+                           : std::min(peer_limit_, limit_);
+    if (outgoing_size_ + submissions_.size() >= limit) {
+      return false;
+    }
+  }
+  Submission submission{to, message, priority};
+  if (!submissions_.TryPush(submission)) {
+    return false;
+  }
+  // Only the first to find the sender waiting needs to wake it, it takes
+  // everything submitted once awake
+  if (sender_waiting_.exchange(false)) {
+    std::scoped_lock lock(outgoing_mutex_);
+    sender_condition_.notify_one();
+  }
+  return true;
+}
 
-  std::string message(receive_buffer_ + sizeof(uint64_t),
-                      length - sizeof(uint64_t));
+void AsyncMailbox::Drain() {
+  Submission submission;
+  while (submissions_.TryPop(submission)) {
+    Queue(submission.to, std::move(submission.message), submission.priority);
+  }
+}
 
-  if (message == "ack") {
-    // Remove associated message from outgoing_messages_
-    std::scoped_lock lock(outgoing_mutex_);
-    for (auto it = outgoing_messages_.begin();
-         it != outgoing_messages_.end();) {
-      if (it->to == from && it->seq_num == seq_num) {
-        outgoing_messages_.erase(it);
-        outgoing_condition_.notify_all();
-        return;
-      } else {
-        it++;
+void AsyncMailbox::Queue(const Address& to, std::string message,
+                         const Priority priority) {
+  const auto lane = static_cast<size_t>(priority);
+  // A peer stays on the network while messages sent to it there await
+  // acknowledgement, so newer messages can't overtake them
+  if (to.IsMulticast() ||
+      (outgoing_messages_[lane].size(to) == 0 && socket_.Reliable(to))) {
+    outgoing_unacknowledged_[lane].emplace_back(
+        std::chrono::system_clock::now(), 0, 0, Address(), to,
+        std::move(message));
+  } else {
+    QueueSequenced(lane, to, std::move(message));
+  }
+  outgoing_size_++;
+  outgoing_queued_ = true;
+  sender_condition_.notify_one();
+}
+
+void AsyncMailbox::QueueSequenced(const size_t lane, const Address& to,
+                                  std::string message) {
+  auto& seq_nums = outgoing_seq_nums_[lane];
+  uint64_t seq_num = 0;
+  if (const auto& it = seq_nums.find(to); it != seq_nums.end()) {
+    seq_num = ++(it->second);
+  } else {
+    seq_nums[to] = 0;
+  }
+  outgoing_messages_[lane].Push(QueuedMessage{std::chrono::system_clock::now(),
+                                              seq_num, 0, Address(), to,
+                                              std::move(message)});
+}
+
+void AsyncMailbox::WakeReceiver() {
+  if (receivers_waiting_ > 0) {
+    std::scoped_lock lock(incoming_mutex_);
+    incoming_condition_.notify_all();
+  }
+}
+
+void AsyncMailbox::Deliver(const Address& to, const std::string& message,
+                           const Priority priority) {
+  // Messages to ourselves never leave the process, but are otherwise received
+  // as though they had
+  const auto length = TrimmedLength(message.data(), message.length());
+  std::scoped_lock lock(incoming_mutex_);
+  incoming_self_[static_cast<size_t>(priority)].emplace_back(
+      std::chrono::system_clock::now(), 0, 0, to, to,
+      message.substr(0, length));
+  incoming_condition_.notify_all();
+}
+
+void AsyncMailbox::BackgroundReceive(const size_t shard,
+                                     std::vector<char>& buffers,
+                                     std::vector<Datagram>& datagrams) {
+  for (size_t i = 0; i < kMaxBatchSize; i++) {
+    datagrams[i].buffer = &buffers[i * kMaxUDPPayload];
+  }
+  const auto count = socket_.ReceiveShard(datagrams, shard);
+  // Held messages are released after a while, even if nothing arrives
+  const bool holding = ordered_ && incoming_held_ > 0;
+  if (count == 0 && !holding) {
+    return;
+  }
+
+  struct Ack {
+    Address from;
+    size_t lane;
+    uint64_t cumulative;
+    uint64_t selective;
+  };
+  std::vector<Ack> acknowledgements;
+  std::array<std::vector<QueuedMessage>, kPriorities> received;
+  std::array<std::vector<QueuedMessage>, kPriorities> delivered;
+  for (size_t i = 0; i < count; i++) {
+    const auto& d = datagrams[i];
+    // Each datagram holds one or more messages, each with its own header
+    size_t offset = 0;
+    while (offset < d.length) {
+      Header header;
+      if (!header.ReadFrom(d.buffer + offset, d.length - offset)) {
+        Error() << "Malformed datagram from " << d.from << std::endl;
+        break;
+      }
+      const char* payload = d.buffer + offset + kHeaderLength;
+      offset += kHeaderLength + header.length;
+      const size_t lane = header.lane;
+      if (lane >= kPriorities) {
+        Error() << "Unknown lane from " << d.from << ": " << lane
+                << std::endl;
+        continue;
+      }
+      const auto length = TrimmedLength(payload, header.length);
+      switch (header.type) {
+        case MessageType::kData:
+          received[lane].emplace_back(std::chrono::system_clock::now(),
+                                      header.seq_num, 0, d.from, d.to,
+                                      std::string(payload, length));
+          break;
+        case MessageType::kAck: {
+          uint64_t selective = 0;
+          if (header.length >= sizeof(uint64_t)) {
+            std::memcpy(&selective, payload, sizeof(uint64_t));
+            selective = be64toh(selective);
+          }
+          acknowledgements.emplace_back(d.from, lane, header.seq_num,
+                                        selective);
+          break;
+        }
+        case MessageType::kUnsequenced:
+          // Multicasts, and messages that can't be lost, are neither
+          // sequenced nor acknowledged
+          delivered[lane].emplace_back(std::chrono::system_clock::now(), 0, 0,
+                                       d.from, d.to,
+                                       std::string(payload, length));
+          break;
+        default:
+          Error() << "Unknown message type from " << d.from << ": "
+                  << static_cast<int>(header.type) << std::endl;
       }
     }
-    Error() << "Failed to find acknowledged message: " << from << ": "
-            << seq_num << std::endl;
-  } else {
-    // Send acknowledgement
-    {
-      // receive_buffer_[0:7] alreadycontains seq_num
-      receive_buffer_[8] = 'a';
-      receive_buffer_[9] = 'c';
-      receive_buffer_[10] = 'k';
-      if (!socket_.Send(from, receive_buffer_, sizeof(uint64_t) + 3)) {
-        Error() << "Failed to acknowledge " << from << ": "
-                << std::strerror(errno) << std::endl;
-      }
-    }
-
-    if (const auto& it = incoming_seq_nums_.find(from);
-        it != incoming_seq_nums_.end()) {
-      if (seq_num <= it->second) {
-        Info() << "Dropping duplicate message: " << from << ": " << seq_num
-               << " <= " << it->second << std ::endl;
-        // Drop duplicate packet
-        // TODO handle sequence number overflow and wrap around
-        return;
+  }
+
+  if (holding || !acknowledgements.empty() ||
+      std::any_of(received.begin(), received.end(),
+                  [](const auto& r) { return !r.empty(); })) {
+    const auto now = std::chrono::system_clock::now();
+    std::scoped_lock lock(outgoing_mutex_);
+
+    // Remove acknowledged messages from outgoing_messages_
+    std::vector<QueuedMessage> acknowledged;
+    bool retired = false;
+    for (const auto& [from, lane, cumulative, selective] : acknowledgements) {
+      acknowledged.clear();
+      if (outgoing_messages_[lane].Acknowledge(from, cumulative, selective,
+                                               acknowledged) == 0) {
+        continue;
+      }
+      retired = true;
+      // Only measure messages that weren't retransmitted (Karn's algorithm),
+      // and only the latest as the acknowledgement may have been delayed for
+      // the earlier ones
+      std::optional<std::chrono::system_clock::time_point> latest;
+      for (const auto& m : acknowledged) {
+        if (m.attempts == 1 && (!latest || m.time > *latest)) {
+          latest = m.time;
+        }
+      }
+      if (latest) {
+        round_trips_[from].Sample(
+            std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                                  *latest));
       }
     }
 
-    // Save sequence number
-    incoming_seq_nums_[from] = seq_num;
+    for (size_t lane = 0; lane < kPriorities; lane++) {
+      // Wake the sender if acknowledgements released held messages
+      if (const auto next = outgoing_messages_[lane].Next();
+          next && *next <= now) {
+        outgoing_queued_ = true;
+      }
 
-    std::scoped_lock lock(incoming_mutex_);
-    incoming_messages_.emplace_back(std::chrono::system_clock::now(), seq_num,
-                                    0, from, to, message);
-    incoming_condition_.notify_all();
+      // Schedule acknowledgement of received messages, including duplicates
+      // in case the previous acknowledgement was lost
+      for (auto& m : received[lane]) {
+        auto [pending, scheduled] =
+            pending_acks_[lane].try_emplace(m.from, now + kAckDelay, 0);
+        if (++pending->second.messages == kWindowSize / 2) {
+          // Don't wait while half the sender's window is unacknowledged
+          pending->second.due = now;
+          scheduled = true;
+        }
+        if (scheduled) {
+          outgoing_queued_ = true;
+        }
+        auto& window = incoming_windows_[lane][m.from];
+        if (!window.Receive(m.seq_num)) {
+          Info() << "Dropping duplicate message: " << m.from << ": "
+                 << m.seq_num << std::endl;
+          continue;
+        }
+        if (!ordered_) {
+          delivered[lane].push_back(std::move(m));
+          continue;
+        }
+        // Hold the message until everything before it has been received, or
+        // given up on
+        const auto from = m.from;
+        auto& held = incoming_reordering_[lane][from];
+        if (held.emplace(m.seq_num, std::move(m)).second) {
+          incoming_held_++;
+        }
+        Release(lane, from, held, now, delivered[lane]);
+      }
+
+      if (holding) {
+        for (auto it = incoming_reordering_[lane].begin();
+             it != incoming_reordering_[lane].end();) {
+          Release(lane, it->first, it->second, now, delivered[lane]);
+          it = it->second.empty() ? incoming_reordering_[lane].erase(it)
+                                  : std::next(it);
+        }
+      }
+    }
+    if (outgoing_queued_) {
+      sender_condition_.notify_one();
+    }
+    if (retired) {
+      // Wake any callers waiting for room to send, or for the mailbox to be
+      // flushed
+      outgoing_size_ = Outgoing();
+      outgoing_condition_.notify_all();
+    }
+  }
+
+  if (std::any_of(delivered.begin(), delivered.end(),
+                  [](const auto& d) { return !d.empty(); })) {
+    for (size_t lane = 0; lane < kPriorities; lane++) {
+      for (auto& m : delivered[lane]) {
+        if (incoming_messages_[lane].TryPush(m)) {
+          continue;
+        }
+        // Hold off receiving more until Receive makes room. The batch's
+        // acknowledgements have already been handled, so senders aren't held
+        // up by this wait.
+        std::unique_lock lock(incoming_mutex_);
+        incoming_condition_.notify_all();
+        deliverers_waiting_++;
+        room_condition_.wait(lock, [&] {
+          return !running_ || incoming_messages_[lane].TryPush(m);
+        });
+        deliverers_waiting_--;
+        if (!running_) {
+          return;
+        }
+      }
+    }
+    WakeReceiver();
   }
 }
 
-void AsyncMailbox::BackgroundReceiveMulticast() {
-  Address from;
-  Address to;
-  size_t length;
-  while (socket_.ReceiveMulticast(from, to, receive_buffer_, length)) {
-    while (receive_buffer_[length - 1] == '\n') {
-      --length;
+void AsyncMailbox::Release(
+    const size_t lane, const Address& from,
+    std::map<uint64_t, QueuedMessage, SequenceLess>& held,
+    const std::chrono::system_clock::time_point now,
+    std::vector<QueuedMessage>& delivered) {
+  auto& window = incoming_windows_[lane][from];
+  while (!held.empty()) {
+    auto& [seq_num, m] = *held.begin();
+    if (SequenceBefore(window.cumulative(), seq_num)) {
+      // Messages before this one are missing, and the sender may have given
+      // up on them, so stop waiting for them eventually
+      if (now - m.time < kReorderTimeout) {
+        return;
+      }
+      Info() << "Giving up on messages from " << from << " before " << seq_num
+             << std::endl;
+      window.Skip(seq_num);
     }
-    std::string message(receive_buffer_, length);
-    std::scoped_lock lock(incoming_mutex_);
-    incoming_messages_.emplace_back(std::chrono::system_clock::now(), 0, 0,
-                                    from, to, message);
-    incoming_condition_.notify_all();
+    delivered.push_back(std::move(m));
+    held.erase(held.begin());
+    incoming_held_--;
   }
 }
 
 void AsyncMailbox::BackgroundSend() {
-  std::unique_lock lock(outgoing_mutex_);
+  size_t ack_count = 0;
+  size_t count = 0;
+  bool expired = false;
+  bool piggybacked = false;
+  std::array<std::deque<QueuedMessage>, kPriorities> unacknowledged;
+  {
+    std::unique_lock lock(outgoing_mutex_);
 
-  if (!outgoing_condition_.wait_for(
-          lock, kSendTimeout, [this] { return !outgoing_messages_.empty(); })) {
-    return;
-  }
+    // Sleep until new messages are queued, or the next retransmission or
+    // acknowledgement is due
+    auto wakeup = std::chrono::system_clock::now() + kSendTimeout;
+    for (size_t lane = 0; lane < kPriorities; lane++) {
+      if (const auto next = outgoing_messages_[lane].Next(); next) {
+        wakeup = std::min(wakeup, *next);
+      }
+      if (!outgoing_unacknowledged_[lane].empty()) {
+        wakeup = std::min(wakeup, unacknowledged_retry_);
+      }
+      for (const auto& [peer, pending] : pending_acks_[lane]) {
+        wakeup = std::min(wakeup, pending.due);
+      }
+      for (const auto& [peer, pending] : pending_packs_[lane]) {
+        wakeup = std::min(wakeup, pending.flush);
+      }
+    }
+    sender_waiting_ = true;
+    sender_condition_.wait_until(lock, wakeup, [this] {
+      return outgoing_queued_ || !running_ || !submissions_.empty();
+    });
+    sender_waiting_ = false;
+    Drain();
+    outgoing_queued_ = false;
+    // Leave messages to reliable peers queued until a busy peer has had time to
+    // make room
+    if (std::chrono::system_clock::now() >= unacknowledged_retry_) {
+      unacknowledged.swap(outgoing_unacknowledged_);
+      // Messages queued for a peer before one of its sends fell back to the
+      // network follow it there, so they stay in order
+      for (size_t lane = 0; lane < kPriorities; lane++) {
+        std::erase_if(unacknowledged[lane], [&](auto& m) {
+          if (m.to.IsMulticast() || outgoing_messages_[lane].size(m.to) == 0) {
+            return false;
+          }
+          QueueSequenced(lane, m.to, std::move(m.message));
+          return true;
+        });
+      }
+    }
 
-  const auto now = std::chrono::system_clock::now();
-  for (auto it = outgoing_messages_.begin(); it != outgoing_messages_.end();) {
-    if (it->attempts >= kMaxRetries) {
-      Error() << "Failed to deliver to " << it->to << " failed after "
-              << std::to_string(it->attempts) << " attempts" << std::endl;
-      it = outgoing_messages_.erase(it);
-      continue;
+    // Fill the batches from the higher lanes first
+    const auto now = std::chrono::system_clock::now();
+
+    // Messages in each datagram
+    struct Packed {
+      size_t lane;
+      size_t bytes;
+      std::vector<Outbox::iterator> messages;
+    };
+    std::vector<Packed> datagrams;
+    for (auto lane = kPriorities; lane-- > 0;) {
+      auto& outgoing = outgoing_messages_[lane];
+      auto& packs = pending_packs_[lane];
+      std::vector<Outbox::iterator> sending;
+      const auto release = [&](const Address& to, const PendingPack& pack) {
+        for (const auto seq_num : pack.seq_nums) {
+          if (const auto it = outgoing.Find(to, seq_num);
+              it != outgoing.end()) {
+            sending.push_back(it);
+          }
+        }
+      };
+
+      // Send messages held for packing once their delay is up
+      for (auto it = packs.begin(); it != packs.end();) {
+        if (it->second.flush > now) {
+          it++;
+          continue;
+        }
+        release(it->first, it->second);
+        it = packs.erase(it);
+      }
+
+      std::vector<Outbox::iterator> due;
+      outgoing.Due(now, due);
+      for (const auto& it : due) {
+        if (it->attempts >= kMaxRetries) {
+          Error() << "Failed to deliver to " << it->to << " failed after "
+                  << std::to_string(it->attempts) << " attempts" << std::endl;
+          outgoing.Erase(it);
+          expired = true;
+          continue;
+        }
+        const size_t record = kHeaderLength + it->message.length();
+        if (it->attempts > 0 || pack_delay_.count() == 0 ||
+            record > pack_size_ || unpacked_.contains(it->to)) {
+          sending.push_back(it);
+          continue;
+        }
+        // Hold new messages in case others follow them to the same peer,
+        // until the delay is up or there are enough to fill a datagram
+        auto [pack, created] =
+            packs.try_emplace(it->to, now + pack_delay_, 0);
+        pack->second.bytes += record;
+        pack->second.seq_nums.push_back(it->seq_num);
+        if (pack->second.bytes >= pack_size_) {
+          release(pack->first, pack->second);
+          packs.erase(pack);
+        }
+      }
+
+      // Pack small messages to the same peer into shared datagrams
+      std::map<const Address, size_t> open;
+      for (const auto& it : sending) {
+        const size_t record = kHeaderLength + it->message.length();
+        const bool packing =
+            record <= pack_size_ && !unpacked_.contains(it->to);
+        if (const auto o = open.find(it->to);
+            packing && o != open.end() &&
+            datagrams[o->second].bytes + record <= pack_size_) {
+          datagrams[o->second].bytes += record;
+          datagrams[o->second].messages.push_back(it);
+        } else if (datagrams.size() == kMaxBatchSize) {
+          // Batch is full, leave the rest for the next pass
+          outgoing.Schedule(it, now);
+          outgoing_queued_ = true;
+          continue;
+        } else {
+          if (packing) {
+            open.insert_or_assign(it->to, datagrams.size());
+          }
+          datagrams.push_back(Packed{lane, record, {it}});
+        }
+
+        // Wait for acknowledgement before retransmitting, with jitter so peers
+        // don't retransmit in lockstep
+        it->time = now;
+        it->attempts++;
+        const auto timeout = round_trips_[it->to].Timeout(it->attempts);
+        std::uniform_int_distribution<int64_t> jitter(0, timeout.count() / 4);
+        const std::chrono::microseconds delay(timeout.count() +
+                                              jitter(random_));
+        outgoing.Schedule(it, now + delay);
+      }
     }
 
-    const auto deadline = it->time + it->attempts * kReceiveTimeout;
-    if (now >= deadline) {
-      // TODO move out of outgoing_mutex_ lock
-      uint64_t seq_num = it->seq_num;
-      std::memcpy(send_buffer_, &seq_num, sizeof(uint64_t));
-      const auto length =
-          std::min(it->message.length(), kMaxUDPPayload - sizeof(uint64_t));
-      std::memcpy(send_buffer_ + sizeof(uint64_t), it->message.c_str(), length);
-      size_t bytes = length + sizeof(uint64_t);
-      if (!socket_.Send(it->to, send_buffer_, bytes)) {
-        Error() << "Failed to unicast " << bytes << " bytes to " << it->to
-                << ": " << std::strerror(errno) << std::endl;
+    for (const auto& [lane, bytes, messages] : datagrams) {
+      auto& buffer = send_buffers_[count];
+      buffer.clear();
+      for (const auto& it : messages) {
+        WriteMessage(buffer, MessageType::kData, lane, it->seq_num,
+                     it->message);
+      }
+      auto& d = sends_[count++];
+      d.to = messages.front()->to;
+
+      // Piggyback any acknowledgements owed to the peer
+      for (size_t l = 0; l < kPriorities; l++) {
+        if (const auto it = pending_acks_[l].find(d.to);
+            it != pending_acks_[l].end() &&
+            buffer.length() + kSelectiveAckLength <= kMaxUDPPayload) {
+          const auto offset = buffer.length();
+          buffer.resize(offset + kSelectiveAckLength);
+          buffer.resize(offset + WriteAck(buffer.data() + offset, l,
+                                          incoming_windows_[l][d.to]));
+          pending_acks_[l].erase(it);
+          piggybacked = true;
+        }
       }
+      d.buffer = buffer.data();
+      d.length = buffer.length();
+    }
 
-      it->attempts++;
+    // Send the remaining acknowledgements that are due on their own
+    for (auto lane = kPriorities; lane-- > 0;) {
+      auto& pending_acks = pending_acks_[lane];
+      for (auto it = pending_acks.begin(); it != pending_acks.end();) {
+        if (it->second.due > now) {
+          it++;
+          continue;
+        }
+        if (ack_count == kMaxBatchSize) {
+          // Batch is full, leave the rest for the next pass
+          outgoing_queued_ = true;
+          break;
+        }
+        auto& ack = acks_[ack_count];
+        ack.buffer = &ack_buffers_[ack_count++ * kSelectiveAckLength];
+        ack.length =
+            WriteAck(ack.buffer, lane, incoming_windows_[lane][it->first]);
+        ack.to = it->first;
+        it = pending_acks.erase(it);
+      }
     }
-    it++;
+    outgoing_size_ = Outgoing();
   }
-}
 
-void AsyncMailbox::BackgroundSendMulticast() {
-  std::unique_lock lock(outgoing_mutex_);
+  // Flush batches outside of outgoing_mutex_
+  if (ack_count > 0) {
+    if (const auto sent = socket_.SendBatch(acks_, ack_count);
+        sent < ack_count) {
+      Error() << "Failed to send " << (ack_count - sent) << " of " << ack_count
+              << " acknowledgements" << std::endl;
+    }
+    // Wake any callers waiting for the mailbox to be flushed
+    outgoing_condition_.notify_all();
+  }
+  if (count > 0) {
+    if (const auto sent = socket_.SendBatch(sends_, count); sent < count) {
+      Error() << "Failed to unicast " << (count - sent) << " of " << count
+              << " packets" << std::endl;
+    }
+  }
+
+  // Wake any callers waiting for room to send, or for the mailbox to be
+  // flushed, once the messages that made room have left
+  bool sent = false;
+  for (auto lane = kPriorities; lane-- > 0;) {
+    sent |= !unacknowledged[lane].empty();
+    BackgroundSendUnacknowledged(lane, unacknowledged[lane]);
+  }
+  if (expired || sent || piggybacked) {
+    outgoing_condition_.notify_all();
+  }
+}
 
-  for (auto it = outgoing_multicasts_.begin();
-       it != outgoing_multicasts_.end();) {
-    const auto bytes = it->message.length();
-    if (!socket_.Send(it->to, it->message.c_str(), bytes)) {
-      Error() << "Failed to multicast " << bytes << " bytes to " << it->to
-              << ": " << std::strerror(errno) << std::endl;
+void AsyncMailbox::BackgroundSendUnacknowledged(
+    const size_t lane, std::deque<QueuedMessage>& messages) {
+  // Messages to reliable peers are sent one at a time, so each can be retried
+  // or rerouted on its own
+  std::string buffer;
+  // Peers that couldn't take a message, whose later messages wait behind it
+  std::set<Address> busy;
+  // Peers no longer reached reliably, whose later messages follow the first
+  // onto the network
+  std::set<Address> rerouted;
+  std::deque<QueuedMessage> retry;
+  std::vector<QueuedMessage> unreachable;
+  size_t count = 0;
+  const auto flush = [&] {
+    if (const auto sent = socket_.SendBatch(sends_, count); sent < count) {
+      Error() << "Failed to send " << (count - sent) << " of " << count
+              << " packets" << std::endl;
+    }
+    count = 0;
+  };
+  for (auto& m : messages) {
+    if (m.to.IsMulticast()) {
+      auto& b = send_buffers_[count];
+      b.clear();
+      WriteMessage(b, MessageType::kUnsequenced, lane, 0, m.message);
+      auto& d = sends_[count++];
+      d.to = m.to;
+      d.buffer = b.data();
+      d.length = b.length();
+      if (count == kMaxBatchSize) {
+        flush();
+      }
+      continue;
     }
-    it = outgoing_multicasts_.erase(it);
+    if (busy.contains(m.to)) {
+      retry.push_back(std::move(m));
+      continue;
+    }
+    if (rerouted.contains(m.to)) {
+      unreachable.push_back(std::move(m));
+      continue;
+    }
+    buffer.clear();
+    WriteMessage(buffer, MessageType::kUnsequenced, lane, 0, m.message);
+    switch (socket_.SendReliable(m.to, buffer.data(), buffer.length())) {
+      case Delivery::kSent:
+        break;
+      case Delivery::kBusy:
+        busy.insert(m.to);
+        retry.push_back(std::move(m));
+        break;
+      case Delivery::kUnreachable:
+        rerouted.insert(m.to);
+        unreachable.push_back(std::move(m));
+        break;
+    }
+  }
+  messages.clear();
+  if (count > 0) {
+    flush();
+  }
+  if (retry.empty() && unreachable.empty()) {
+    return;
+  }
+
+  std::scoped_lock lock(outgoing_mutex_);
+  // Ahead of anything queued since, so each peer's messages stay in order
+  auto& queued = outgoing_unacknowledged_[lane];
+  queued.insert(queued.begin(), std::make_move_iterator(retry.begin()),
+                std::make_move_iterator(retry.end()));
+  if (!retry.empty()) {
+    unacknowledged_retry_ =
+        std::chrono::system_clock::now() + kBusyRetryInterval;
+  }
+  // Fall back to acknowledging and retransmitting over the network
+  for (auto& m : unreachable) {
+    QueueSequenced(lane, m.to, std::move(m.message));
   }
+  outgoing_size_ = Outgoing();
+  outgoing_queued_ = true;
 }
@@ -0,0 +1,38 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/header.h>
+#include <endian.h>
+
+#include <cstring>
+
+void Header::WriteTo(char* buffer) const {
+  const uint16_t l = htobe16(length);
+  const uint16_t reserved = 0;
+  const uint64_t s = htobe64(seq_num);
+  buffer[0] = static_cast<char>(version);
+  buffer[1] = static_cast<char>(type);
+  buffer[2] = static_cast<char>(flags);
+  buffer[3] = static_cast<char>(lane);
+  std::memcpy(buffer + 4, &l, sizeof(uint16_t));
+  std::memcpy(buffer + 6, &reserved, sizeof(uint16_t));
+  std::memcpy(buffer + 8, &s, sizeof(uint64_t));
+}
+
+bool Header::ReadFrom(const char* buffer, const size_t size) {
+  if (size < kHeaderLength) {
+    return false;
+  }
+  version = static_cast<uint8_t>(buffer[0]);
+  if (version != kWireVersion) {
+    return false;
+  }
+  uint16_t l;
+  uint64_t s;
+  type = static_cast<MessageType>(buffer[1]);
+  flags = static_cast<uint8_t>(buffer[2]);
+  lane = static_cast<uint8_t>(buffer[3]);
+  std::memcpy(&l, buffer + 4, sizeof(uint16_t));
+  std::memcpy(&s, buffer + 8, sizeof(uint64_t));
+  length = be16toh(l);
+  seq_num = be64toh(s);
+  return size - kHeaderLength >= length;
+}
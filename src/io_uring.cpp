@@ -0,0 +1,219 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/io_uring.h>
+#include <Wink/log.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int IOUringSetup(const unsigned entries, io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int IOUringEnter(const int fd, const unsigned submit, const unsigned wait,
+                 const unsigned flags) {
+  return syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0);
+}
+
+int IOUringRegister(const int fd, const unsigned opcode, void* arg,
+                    const unsigned count) {
+  return syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+// Positions in the queues are shared with the kernel, which reads what was
+// written before they advance
+unsigned LoadPosition(unsigned* position) {
+  return std::atomic_ref(*position).load(std::memory_order_acquire);
+}
+
+void StorePosition(unsigned* position, const unsigned value) {
+  std::atomic_ref(*position).store(value, std::memory_order_release);
+}
+
+IOUring::IOUring(const unsigned entries) {
+  fd_ = IOUringSetup(entries, &params_);
+  if (fd_ < 0) {
+    throw std::runtime_error(std::string("Failed to set up io_uring: ") +
+                             std::strerror(errno));
+  }
+
+  // Map the submission and completion queues, which older kernels keep apart
+  sq_ring_size_ =
+      params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+  const bool single = params_.features & IORING_FEAT_SINGLE_MMAP;
+  if (single) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    close(fd_);
+    throw std::runtime_error(
+        std::string("Failed to map io_uring submission queue: ") +
+        std::strerror(errno));
+  }
+  if (single) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      munmap(sq_ring_, sq_ring_size_);
+      close(fd_);
+      throw std::runtime_error(
+          std::string("Failed to map io_uring completion queue: ") +
+          std::strerror(errno));
+    }
+  }
+  sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    if (!single) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    close(fd_);
+    throw std::runtime_error(
+        std::string("Failed to map io_uring submissions: ") +
+        std::strerror(errno));
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  auto sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.tail);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+  auto cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.tail);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+
+  // Learn which operations the kernel supports
+  std::vector<char> probe(sizeof(io_uring_probe) +
+                          256 * sizeof(io_uring_probe_op));
+  auto p = reinterpret_cast<io_uring_probe*>(probe.data());
+  if (IOUringRegister(fd_, IORING_REGISTER_PROBE, p, 256) == 0) {
+    for (unsigned i = 0; i < p->ops_len; i++) {
+      if (p->ops[i].flags & IO_URING_OP_SUPPORTED) {
+        supported_.push_back(p->ops[i].op);
+      }
+    }
+  }
+}
+
+IOUring::~IOUring() {
+  // Closing the ring cancels any operations still in flight
+  close(fd_);
+  if (buffer_ring_) {
+    munmap(buffer_ring_, buffer_ring_size_);
+  }
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+}
+
+bool IOUring::Supports(const uint8_t opcode) const {
+  for (const auto s : supported_) {
+    if (s == opcode) {
+      return true;
+    }
+  }
+  return false;
+}
+
+io_uring_sqe* IOUring::Prepare() {
+  const unsigned tail = *sq_tail_ + prepared_;
+  if (tail - LoadPosition(sq_head_) >= params_.sq_entries) {
+    return nullptr;
+  }
+  const unsigned index = tail & (params_.sq_entries - 1);
+  sq_array_[index] = index;
+  prepared_++;
+  auto sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(io_uring_sqe));
+  return sqe;
+}
+
+bool IOUring::Submit(const unsigned wait) {
+  const unsigned submit = prepared_;
+  StorePosition(sq_tail_, *sq_tail_ + submit);
+  prepared_ = 0;
+  unsigned submitted = 0;
+  do {
+    const int result = IOUringEnter(fd_, submit - submitted, wait,
+                                    wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      Error() << "Failed to submit to io_uring: " << std::strerror(errno)
+              << std::endl;
+      return false;
+    }
+    submitted += result;
+  } while (submitted < submit);
+  return true;
+}
+
+bool IOUring::Complete(io_uring_cqe& cqe) {
+  const unsigned head = *cq_head_;
+  if (head == LoadPosition(cq_tail_)) {
+    return false;
+  }
+  cqe = cqes_[head & (params_.cq_entries - 1)];
+  StorePosition(cq_head_, head + 1);
+  return true;
+}
+
+bool IOUring::Provide(const uint16_t group, char* buffers, const uint32_t size,
+                      const uint16_t count) {
+  buffer_ring_size_ = count * sizeof(io_uring_buf);
+  void* ring = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring == MAP_FAILED) {
+    Error() << "Failed to map io_uring buffer ring: " << std::strerror(errno)
+            << std::endl;
+    return false;
+  }
+  io_uring_buf_reg registration = {};
+  registration.ring_addr = reinterpret_cast<uint64_t>(ring);
+  registration.ring_entries = count;
+  registration.bgid = group;
+  if (IOUringRegister(fd_, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+    munmap(ring, buffer_ring_size_);
+    return false;
+  }
+  buffer_ring_ = static_cast<io_uring_buf*>(ring);
+  buffers_ = buffers;
+  buffer_size_ = size;
+  buffer_count_ = count;
+  for (uint16_t id = 0; id < count; id++) {
+    Return(id);
+  }
+  return true;
+}
+
+void IOUring::Return(const uint16_t id) {
+  // Ring's tail overlays the reserved field of its first buffer
+  std::atomic_ref tail(buffer_ring_[0].resv);
+  const uint16_t position = tail.load(std::memory_order_relaxed);
+  auto& buffer = buffer_ring_[position & (buffer_count_ - 1)];
+  buffer.addr = reinterpret_cast<uint64_t>(buffers_ + id * buffer_size_);
+  buffer.len = buffer_size_;
+  buffer.bid = id;
+  tail.store(position + 1, std::memory_order_release);
+}
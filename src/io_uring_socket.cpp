@@ -0,0 +1,256 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/constants.h>
+#include <Wink/io_uring.h>
+#include <Wink/log.h>
+#include <Wink/socket.h>
+#include <netinet/udp.h>
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Each provided buffer receives the kernel's description of the datagram, then
+// the sender's address, then the payload
+constexpr size_t kReceiveBufferSize =
+    sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + kMaxUDPPayload;
+
+IOUringSocket::IOUringSocket(Address& address)
+    : UDPSocket(address),
+      receive_buffers_(kIOUringBufferCount * kReceiveBufferSize) {
+  try {
+    receive_ring_ = std::make_unique<IOUring>(kIOUringBufferCount);
+    send_ring_ = std::make_unique<IOUring>(kMaxBatchSize);
+  } catch (const std::runtime_error& e) {
+    Info() << e.what() << ", falling back to UDP" << std::endl;
+    receive_ring_.reset();
+    send_ring_.reset();
+    return;
+  }
+  if (!receive_ring_->Supports(IORING_OP_RECVMSG) ||
+      !send_ring_->Supports(IORING_OP_SENDMSG) ||
+      !receive_ring_->Provide(0, receive_buffers_.data(), kReceiveBufferSize,
+                              kIOUringBufferCount)) {
+    Info() << "Kernel lacks io_uring support, falling back to UDP"
+           << std::endl;
+    receive_ring_.reset();
+    send_ring_.reset();
+    return;
+  }
+
+  // Multishot receives don't report the segment size of coalesced datagrams,
+  // so have the kernel split them
+  const int off = 0;
+  setsockopt(unicast_socket_, IPPROTO_UDP, UDP_GRO, &off, sizeof(int));
+
+  // Unicast datagrams are now received by the ring, so wait on it instead
+  receive_header_.msg_namelen = sizeof(sockaddr_in);
+  if (!Unwatch(unicast_socket_) || !Watch(receive_ring_->fd()) || !Arm()) {
+    throw std::runtime_error("Failed to receive through io_uring");
+  }
+}
+
+IOUringSocket::~IOUringSocket() {}
+
+bool IOUringSocket::Receive(Address& from, Address& to, char* buffer,
+                            size_t& length) {
+  std::unique_lock lock(receive_mutex_);
+  if (!receive_ring_) {
+    lock.unlock();
+    return UDPSocket::Receive(from, to, buffer, length);
+  }
+  std::vector<Datagram> datagrams(1);
+  datagrams[0].buffer = buffer;
+  if (Complete(datagrams) == 0) {
+    if (!receive_ring_) {
+      lock.unlock();
+      return UDPSocket::Receive(from, to, buffer, length);
+    }
+    pollfd ring = {receive_ring_->fd(), POLLIN, 0};
+    const int timeout =
+        std::chrono::duration_cast<std::chrono::milliseconds>(kReceiveTimeout)
+            .count();
+    if (poll(&ring, 1, timeout) <= 0 || Complete(datagrams) == 0) {
+      return false;
+    }
+  }
+  from = datagrams[0].from;
+  to = datagrams[0].to;
+  length = datagrams[0].length;
+  return true;
+}
+
+size_t IOUringSocket::ReceiveBatch(std::vector<Datagram>& datagrams) {
+  // Take whatever multicast groups have without waiting, so a busy ring can't
+  // starve them
+  if (const auto count =
+          UDPSocket::ReceiveBatch(datagrams, std::chrono::milliseconds(0));
+      count > 0) {
+    return count;
+  }
+  std::unique_lock lock(receive_mutex_);
+  if (!receive_ring_) {
+    lock.unlock();
+    return UDPSocket::ReceiveBatch(datagrams);
+  }
+  if (const auto count = Complete(datagrams); count > 0) {
+    return count;
+  }
+  // Wait on both, the ring is watched but left for us to complete
+  lock.unlock();
+  if (const auto count = UDPSocket::ReceiveBatch(datagrams); count > 0) {
+    return count;
+  }
+  lock.lock();
+  if (!receive_ring_) {
+    return 0;
+  }
+  return Complete(datagrams);
+}
+
+size_t IOUringSocket::SendBatch(const std::vector<Datagram>& datagrams,
+                                const size_t count) {
+  std::unique_lock lock(send_ring_mutex_);
+  if (!send_ring_) {
+    lock.unlock();
+    return UDPSocket::SendBatch(datagrams, count);
+  }
+
+  std::vector<sockaddr_in> addresses(count);
+  std::vector<iovec> iovecs(count);
+  std::vector<msghdr> headers(count);
+  for (size_t i = 0; i < count; i++) {
+    datagrams[i].to.WriteTo(addresses[i]);
+    iovecs[i].iov_base = datagrams[i].buffer;
+    iovecs[i].iov_len = datagrams[i].length;
+    headers[i] = {};
+    headers[i].msg_name = &addresses[i];
+    headers[i].msg_namelen = sizeof(struct sockaddr_in);
+    headers[i].msg_iov = &iovecs[i];
+    headers[i].msg_iovlen = 1;
+  }
+
+  size_t sent = 0;
+  size_t offset = 0;
+  while (offset < count) {
+    // Link the sends so they leave in order, with one system call per batch
+    unsigned submitted = 0;
+    io_uring_sqe* previous = nullptr;
+    while (offset + submitted < count) {
+      auto sqe = send_ring_->Prepare();
+      if (!sqe) {
+        break;
+      }
+      const auto i = offset + submitted++;
+      sqe->opcode = IORING_OP_SENDMSG;
+      sqe->fd = unicast_socket_;
+      sqe->addr = reinterpret_cast<uint64_t>(&headers[i]);
+      sqe->len = 1;
+      sqe->user_data = i;
+      if (previous) {
+        previous->flags |= IOSQE_IO_LINK;
+      }
+      previous = sqe;
+    }
+    if (!send_ring_->Submit(submitted)) {
+      return sent;
+    }
+
+    // A failed send cancels the rest of the chain, so skip the datagram that
+    // failed and carry on with the rest
+    size_t next = offset + submitted;
+    io_uring_cqe cqe;
+    for (unsigned i = 0; i < submitted && send_ring_->Complete(cqe); i++) {
+      if (cqe.res >= 0) {
+        sent++;
+      } else if (cqe.res == -ECANCELED) {
+        next = std::min<size_t>(next, cqe.user_data);
+      } else {
+        Error() << "Failed to send unicast packet to "
+                << datagrams[cqe.user_data].to << ": "
+                << std::strerror(-cqe.res) << std::endl;
+      }
+    }
+    offset = next;
+  }
+  return sent;
+}
+
+bool IOUringSocket::enabled() {
+  std::scoped_lock lock(receive_mutex_);
+  return receive_ring_ != nullptr;
+}
+
+bool IOUringSocket::Arm() {
+  // Receive continues until the kernel runs out of buffers
+  auto sqe = receive_ring_->Prepare();
+  if (!sqe) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = unicast_socket_;
+  sqe->addr = reinterpret_cast<uint64_t>(&receive_header_);
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = 0;
+  return receive_ring_->Submit();
+}
+
+void IOUringSocket::Disable() {
+  Info() << "Kernel lacks multishot receive, falling back to UDP" << std::endl;
+  Unwatch(receive_ring_->fd());
+  Watch(unicast_socket_);
+  receive_ring_.reset();
+}
+
+size_t IOUringSocket::Complete(std::vector<Datagram>& datagrams) {
+  size_t received = 0;
+  bool armed = true;
+  io_uring_cqe cqe;
+  while (received < datagrams.size() && receive_ring_->Complete(cqe)) {
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      armed = false;
+    }
+    if (cqe.res < 0) {
+      if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+        Disable();
+        return received;
+      }
+      if (cqe.res != -ENOBUFS) {
+        Error() << "Failed to receive unicast packet: "
+                << std::strerror(-cqe.res) << std::endl;
+      }
+      continue;
+    }
+    if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+      continue;
+    }
+    const uint16_t id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+    const char* buffer = &receive_buffers_[id * kReceiveBufferSize];
+    io_uring_recvmsg_out out;
+    std::memcpy(&out, buffer, sizeof(out));
+    if (out.payloadlen > 0) {
+      sockaddr_in address;
+      std::memcpy(&address, buffer + sizeof(out), sizeof(address));
+      auto& d = datagrams[received++];
+      std::memcpy(d.buffer,
+                  buffer + sizeof(out) + receive_header_.msg_namelen +
+                      receive_header_.msg_controllen,
+                  out.payloadlen);
+      d.from.ReadFrom(address);
+      d.to = address_;
+      d.length = out.payloadlen;
+    }
+    receive_ring_->Return(id);
+  }
+  if (!armed && !Arm()) {
+    Error() << "Failed to rearm io_uring receive" << std::endl;
+  }
+  return received;
+}
@@ -1,6 +1,9 @@
 // Copyright 2022-2025 Stuart Scott
 #include <Wink/machine.h>
 
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -21,12 +24,13 @@ void Machine::Start(const std::string& initial) {
   Info() << uid_ << " started" << std::endl;
 
   // Notify parent of start
-  Send(parent_, "started " + name_);
+  Send(parent_, "started " + name_, Priority::kHigh);
 
   // Register with server
   RegisterMachine(name_, getpid());
 
   if (!states_.empty()) {
+    Compile();
     std::string state = current_;
     if (!initial.empty()) {
       state = initial;
@@ -35,16 +39,17 @@ void Machine::Start(const std::string& initial) {
     Transition(state);
 
     // Loop receiving messages
-    auto last = std::chrono::system_clock::now();
+    auto pulse = std::chrono::system_clock::now() + kPulseInterval;
     while (running_ && !got_sigterm) {
       const auto now = std::chrono::system_clock::now();
       CheckChildren(now);  // Check every loop
-      if (now - last > kPulseInterval) {
+      if (now >= pulse) {
         SendPulse();  // Send every kPulseInterval
-        last = now;
+        pulse = now + kPulseInterval;
       }
-      SendScheduled(now);   // Send any scheduled messages
-      ReceiveMessage(now);  // Waits up to kReceiveTimeout for message
+      SendScheduled(now);  // Send any scheduled messages
+      // Waits for messages until the next timer is due
+      ReceiveMessages(NextDeadline(now, pulse));
     }
 
     // Exit current state
@@ -64,11 +69,11 @@ void Machine::Start(const std::string& initial) {
     oss << error_message_;
 
     // Notify parent of error
-    Send(parent_, oss.str());
+    Send(parent_, oss.str(), Priority::kHigh);
   }
 
   // Notify parent of exit
-  Send(parent_, "exited " + name_);
+  Send(parent_, "exited " + name_, Priority::kHigh);
 
   // Unregister with server
   UnregisterMachine();
@@ -77,9 +82,15 @@ void Machine::Start(const std::string& initial) {
   for (const auto& [k, v] : spawned_) {
     Address address;
     std::istringstream iss(k);
-    iss >> address;
+    try {
+      iss >> address;
+    } catch (const std::logic_error& e) {
+      ::Error() << "Invalid spawned address " << k << ": " << e.what()
+                << std::endl;
+      continue;
+    }
     Address server(address.ip(), kServerPort);
-    Send(server, "stop " + std::to_string(address.port()));
+    Send(server, "stop " + std::to_string(address.port()), Priority::kHigh);
   }
 
   while (!mailbox_.Flushed()) {
@@ -106,6 +117,7 @@ void Machine::AddState(State state) {
     current_ = n;
   }
   states_.emplace(n, state);
+  compiled_ = false;
 }
 
 void Machine::Transition(const std::string& state) {
@@ -142,6 +154,7 @@ void Machine::Transition(const std::string& state) {
   }
 
   current_ = state;
+  current_dispatch_ = nullptr;
 
   // Enter new state hierarchy
   for (const auto& s : next_lineage) {
@@ -149,21 +162,46 @@ void Machine::Transition(const std::string& state) {
   }
 }
 
-void Machine::Send(const Address& to, const std::string& message) {
+void Machine::Send(const Address& to, const std::string& message,
+                   const Priority priority) {
   Info() << uid_ << " > " << to << ' ' << message << std::endl;
-  mailbox_.Send(to, message);
+  mailbox_.Send(to, message, priority);
 }
 
-void Machine::SendAt(const Address& to, const std::string& message,
-                     const std::chrono::system_clock::time_point time) {
-  queue_.push_back(ScheduledMessage{to, message, time});
+bool Machine::TrySend(const Address& to, const std::string& message,
+                      const std::chrono::system_clock::time_point deadline) {
+  if (!mailbox_.TrySend(to, message, deadline)) {
+    return false;
+  }
+  Info() << uid_ << " > " << to << ' ' << message << std::endl;
+  return true;
 }
 
-void Machine::SendAfter(const Address& to, const std::string& message,
-                        const std::chrono::seconds delay) {
-  auto time = std::chrono::system_clock::now();
-  time += delay;
-  SendAt(to, message, time);
+uint64_t Machine::SendAt(const Address& to, const std::string& message,
+                        const std::chrono::system_clock::time_point time) {
+  return Schedule(to, message, time, std::chrono::system_clock::duration(0));
+}
+
+uint64_t Machine::SendAfter(const Address& to, const std::string& message,
+                            const std::chrono::system_clock::duration delay) {
+  return SendAt(to, message, std::chrono::system_clock::now() + delay);
+}
+
+uint64_t Machine::SendEvery(const Address& to, const std::string& message,
+                            const std::chrono::system_clock::duration period) {
+  return Schedule(to, message, std::chrono::system_clock::now() + period,
+                  period);
+}
+
+bool Machine::Cancel(const uint64_t handle) {
+  std::scoped_lock lock(timers_mutex_);
+  const auto it = scheduled_.find(handle);
+  if (it == scheduled_.end()) {
+    return false;
+  }
+  timers_.Cancel(it->second.timer);
+  scheduled_.erase(it);
+  return true;
 }
 
 void Machine::Spawn(const std::string& machine) {
@@ -196,13 +234,13 @@ void Machine::Spawn(const std::string& machine, const Address& destination,
     oss << a;
   }
   const auto s = oss.str();
-  Send(server, s);
+  Send(server, s, Priority::kHigh);
 }
 
 void Machine::CheckChildren(const std::chrono::system_clock::time_point now) {
   std::vector<std::string> dead;
   for (const auto& [k, v] : spawned_) {
-    if (const auto d = now - v.second; d > kHeartbeatTimeout) {
+    if (const auto d = now - v.second; d >= kHeartbeatTimeout) {
       dead.push_back(k);
     }
   }
@@ -214,7 +252,14 @@ void Machine::CheckChildren(const std::chrono::system_clock::time_point now) {
 
       Address address;
       std::istringstream iss(k);
-      iss >> address;
+      try {
+        iss >> address;
+      } catch (const std::logic_error& e) {
+        ::Error() << "Invalid spawned address " << k << ": " << e.what()
+                  << std::endl;
+        spawned_.erase(it);
+        continue;
+      }
 
       {
         // Send errored message
@@ -236,26 +281,82 @@ void Machine::CheckChildren(const std::chrono::system_clock::time_point now) {
   }
 }
 
-void Machine::SendPulse() { Send(parent_, "pulsed " + name_); }
+void Machine::SendPulse() {
+  Send(parent_, "pulsed " + name_, Priority::kHigh);
+}
 
 void Machine::SendScheduled(const std::chrono::system_clock::time_point now) {
-  std::vector<ScheduledMessage> q;
-  q.swap(queue_);
-  for (const auto& e : q) {
-    if (e.time < now) {
-      Send(e.address, e.message);
-    } else {
-      queue_.push_back(e);
+  std::vector<std::pair<Address, std::string>> due;
+  {
+    std::scoped_lock lock(timers_mutex_);
+    due_.clear();
+    timers_.Advance(now, due_);
+    for (const auto handle : due_) {
+      const auto it = scheduled_.find(handle);
+      auto& e = it->second;
+      if (e.period == std::chrono::system_clock::duration(0)) {
+        due.emplace_back(e.address, std::move(e.message));
+        scheduled_.erase(it);
+        continue;
+      }
+      due.emplace_back(e.address, e.message);
+      // Reschedule from when it was due rather than now, so it doesn't drift,
+      // skipping any sends missed while busy
+      e.time += e.period;
+      if (e.time <= now) {
+        e.time += e.period * ((now - e.time) / e.period + 1);
+      }
+      e.timer = timers_.Schedule(e.time, handle);
     }
   }
+
+  // Send without holding the lock, as sending may wait for room
+  for (const auto& [to, message] : due) {
+    Send(to, message);
+  }
 }
 
-void Machine::ReceiveMessage(const std::chrono::system_clock::time_point now) {
-  Address from;
-  Address to;
-  std::string message;
-  if (mailbox_.Receive(from, to, message)) {
-    HandleMessage(now, from, to, message);
+uint64_t Machine::Schedule(const Address& to, const std::string& message,
+                           const std::chrono::system_clock::time_point time,
+                           const std::chrono::system_clock::duration period) {
+  std::scoped_lock lock(timers_mutex_);
+  const auto handle = next_handle_++;
+  const auto timer = timers_.Schedule(time, handle);
+  scheduled_.emplace(handle,
+                     ScheduledMessage{to, message, time, period, timer});
+  return handle;
+}
+
+std::chrono::system_clock::time_point Machine::NextDeadline(
+    const std::chrono::system_clock::time_point now,
+    const std::chrono::system_clock::time_point pulse) {
+  // Wake at least every kReceiveTimeout, to pick up messages scheduled by
+  // other threads
+  auto deadline = std::min(pulse, now + kReceiveTimeout);
+  {
+    std::scoped_lock lock(timers_mutex_);
+    if (const auto next = timers_.Next(); next) {
+      deadline = std::min(deadline, *next);
+    }
+  }
+  for (const auto& [k, v] : spawned_) {
+    deadline = std::min(deadline, v.second + kHeartbeatTimeout);
+  }
+  return deadline;
+}
+
+void Machine::ReceiveMessages(
+    const std::chrono::system_clock::time_point deadline) {
+  if (mailbox_.ReceiveBatch(received_, kReceiveBatch, deadline) == 0) {
+    return;
+  }
+  const auto now = std::chrono::system_clock::now();
+  for (const auto& m : received_) {
+    // Leave the rest unhandled once exiting, as one at a time would
+    if (!running_ || got_sigterm) {
+      break;
+    }
+    HandleMessage(now, m.from, m.to, m.message);
   }
 }
 
@@ -290,26 +391,29 @@ void Machine::HandleMessage(const std::chrono::system_clock::time_point now,
   }
 
   // Receivers
-  auto s = current_;
-  while (!s.empty()) {
-    if (const auto it = states_.find(s); it != states_.end()) {
-      const auto rs = it->second.receivers_;
-      if (const auto i = rs.find(t); i != rs.end()) {
-        i->second(from, to, iss);
-        return;
-      } else if (const auto i = rs.find(""); i != rs.end()) {
-        std::istringstream iss(message);
-        i->second(from, to, iss);
-        return;
-      } else {
-        // Message not handled by state, try parent
-        s = it->second.parent_;
-      }
-    } else {
-      ::Error() << uid_ << ": No such state: " << s << std::endl;
-      Error("Unrecognized state: " + s);
+  if (!compiled_) {
+    Compile();
+  }
+  if (!current_dispatch_) {
+    current_dispatch_ = &dispatch_.at(current_);
+  }
+  const auto& d = *current_dispatch_;
+  if (const auto it = types_.find(t); it != types_.end()) {
+    if (const auto r = d.receivers[it->second]; r) {
+      (*r)(from, to, iss);
+      return;
     }
   }
+  if (d.wildcard) {
+    std::istringstream iss(message);
+    (*d.wildcard)(from, to, iss);
+    return;
+  }
+  if (!d.missing.empty()) {
+    ::Error() << uid_ << ": No such state: " << d.missing << std::endl;
+    Error("Unrecognized state: " + d.missing);
+    return;
+  }
   if (t != "exit") {
     // Message not handled by hierarchy
     ::Error() << uid_ << ": Failed to handle message: \"" << t << "\""
@@ -325,12 +429,55 @@ void Machine::RegisterMachine(const std::string& machine, const int pid) {
   oss << ' ';
   oss << pid;
   Address server(address_.ip(), kServerPort);
-  Send(server, oss.str());
+  Send(server, oss.str(), Priority::kHigh);
 }
 
 void Machine::UnregisterMachine() {
   Address server(address_.ip(), kServerPort);
-  Send(server, "unregister");
+  Send(server, "unregister", Priority::kHigh);
+}
+
+void Machine::Compile() {
+  // Intern every message type any state receives
+  types_.clear();
+  for (const auto& [n, state] : states_) {
+    for (const auto& [t, r] : state.receivers_) {
+      if (!t.empty()) {
+        types_.try_emplace(t, types_.size());
+      }
+    }
+  }
+
+  // Each state takes the receivers of its ancestors, nearest first, up to and
+  // including the first with a wildcard, which hides those above it
+  dispatch_.clear();
+  for (const auto& [n, state] : states_) {
+    auto& d = dispatch_[n];
+    d.receivers.assign(types_.size(), nullptr);
+    auto s = n;
+    while (!s.empty()) {
+      const auto it = states_.find(s);
+      if (it == states_.end()) {
+        d.missing = s;
+        break;
+      }
+      const auto& rs = it->second.receivers_;
+      for (const auto& [t, r] : rs) {
+        if (!t.empty()) {
+          if (auto& receiver = d.receivers[types_.at(t)]; !receiver) {
+            receiver = &r;
+          }
+        }
+      }
+      if (const auto w = rs.find(""); w != rs.end()) {
+        d.wildcard = &w->second;
+        break;
+      }
+      s = it->second.parent_;
+    }
+  }
+  current_dispatch_ = nullptr;
+  compiled_ = true;
 }
 
 std::vector<std::string> Machine::StateLineage(const std::string& state) {
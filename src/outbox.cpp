@@ -0,0 +1,155 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/outbox.h>
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+void Outbox::Push(QueuedMessage message) {
+  const auto it = messages_.insert(messages_.end(), std::move(message));
+  auto& entries = index_[it->to];
+  const bool held = !entries.empty() &&
+                    it->seq_num - entries.begin()->first >= kWindowSize;
+  entries[it->seq_num] = Entry{it, std::nullopt, held};
+  if (!held) {
+    unscheduled_.emplace_back(it->to, it->seq_num);
+  }
+}
+
+Outbox::iterator Outbox::Find(const Address& to, const uint64_t seq_num) {
+  if (const auto entry = FindEntry(to, seq_num); entry) {
+    return entry->message;
+  }
+  return messages_.end();
+}
+
+void Outbox::Schedule(iterator it,
+                      const std::chrono::system_clock::time_point time) {
+  if (const auto entry = FindEntry(it->to, it->seq_num); entry) {
+    if (entry->transmission) {
+      transmissions_.Cancel(*entry->transmission);
+    }
+    entry->transmission = transmissions_.Schedule(time, it);
+  }
+}
+
+void Outbox::Due(const std::chrono::system_clock::time_point now,
+                 std::vector<iterator>& due) {
+  for (const auto& [to, seq_num] : unscheduled_) {
+    if (const auto entry = FindEntry(to, seq_num);
+        entry && !entry->transmission) {
+      due.push_back(entry->message);
+    }
+  }
+  unscheduled_.clear();
+  transmissions_.Advance(now, due);
+}
+
+std::optional<std::chrono::system_clock::time_point> Outbox::Next() const {
+  if (!unscheduled_.empty()) {
+    return std::chrono::system_clock::time_point::min();
+  }
+  return transmissions_.Next();
+}
+
+bool Outbox::Acknowledge(const Address& to, const uint64_t seq_num) {
+  const auto it = Find(to, seq_num);
+  if (it == messages_.end()) {
+    return false;
+  }
+  Erase(it);
+  return true;
+}
+
+size_t Outbox::Acknowledge(const Address& to, const uint64_t cumulative,
+                           const uint64_t selective,
+                           std::vector<QueuedMessage>& acknowledged) {
+  const auto peer = index_.find(to);
+  if (peer == index_.end()) {
+    return 0;
+  }
+  auto& entries = peer->second;
+  size_t count = 0;
+  auto entry = entries.begin();
+  while (entry != entries.end() &&
+         !SequenceBefore(cumulative, entry->first)) {
+    acknowledged.push_back(std::move(*entry->second.message));
+    entry = Erase(entries, entry);
+    count++;
+  }
+  // Bit i of selective acknowledges cumulative + 1 + i
+  while (selective != 0 && entry != entries.end() &&
+         entry->first - cumulative - 1 < 64) {
+    if ((selective >> (entry->first - cumulative - 1)) & 1) {
+      acknowledged.push_back(std::move(*entry->second.message));
+      entry = Erase(entries, entry);
+      count++;
+    } else {
+      entry++;
+    }
+  }
+  if (entries.empty()) {
+    index_.erase(peer);
+  } else if (count > 0) {
+    Release(entries);
+  }
+  return count;
+}
+
+size_t Outbox::size(const Address& to) const {
+  if (const auto peer = index_.find(to); peer != index_.end()) {
+    return peer->second.size();
+  }
+  return 0;
+}
+
+Outbox::iterator Outbox::Erase(iterator it) {
+  const auto next = std::next(it);
+  if (const auto peer = index_.find(it->to); peer != index_.end()) {
+    if (const auto entry = peer->second.find(it->seq_num);
+        entry != peer->second.end()) {
+      Erase(peer->second, entry);
+      if (peer->second.empty()) {
+        index_.erase(peer);
+      } else {
+        Release(peer->second);
+      }
+      return next;
+    }
+  }
+  return messages_.erase(it);
+}
+
+Outbox::Entry* Outbox::FindEntry(const Address& to, const uint64_t seq_num) {
+  const auto peer = index_.find(to);
+  if (peer == index_.end()) {
+    return nullptr;
+  }
+  const auto entry = peer->second.find(seq_num);
+  if (entry == peer->second.end()) {
+    return nullptr;
+  }
+  return &entry->second;
+}
+
+Outbox::Entries::iterator Outbox::Erase(Entries& entries,
+                                        Entries::iterator entry) {
+  if (const auto transmission = entry->second.transmission; transmission) {
+    transmissions_.Cancel(*transmission);
+  }
+  messages_.erase(entry->second.message);
+  return entries.erase(entry);
+}
+
+void Outbox::Release(Entries& entries) {
+  const auto oldest = entries.begin()->first;
+  for (auto& [seq_num, entry] : entries) {
+    if (seq_num - oldest >= kWindowSize) {
+      break;
+    }
+    if (entry.held) {
+      entry.held = false;
+      unscheduled_.emplace_back(entry.message->to, seq_num);
+    }
+  }
+}
@@ -0,0 +1,110 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/address.h>
+#include <Wink/resolver.h>
+
+#include <arpa/inet.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Resolution failed if the hostname didn't become an IP address
+bool Resolved(const std::string& ip) {
+  in_addr address;
+  return inet_pton(AF_INET, ip.c_str(), &address) == 1;
+}
+
+Resolver::Resolver(const std::chrono::milliseconds ttl,
+                   std::function<std::string(const std::string&)> resolve)
+    : ttl_(ttl),
+      resolve_(resolve ? std::move(resolve)
+                       : [](const std::string& h) { return ::Resolve(h); }) {}
+
+Resolver::~Resolver() {
+  {
+    std::scoped_lock lock(mutex_);
+    running_ = false;
+  }
+  condition_.notify_all();
+  if (refresher_.joinable()) {
+    refresher_.join();
+  }
+}
+
+Resolver& Resolver::Instance() {
+  static Resolver resolver;
+  return resolver;
+}
+
+std::string Resolver::Resolve(const std::string& hostname) {
+  {
+    std::scoped_lock lock(mutex_);
+    if (auto it = entries_.find(hostname); it != entries_.end()) {
+      it->second.used = true;
+      return it->second.ip;
+    }
+  }
+
+  // Resolve without holding the lock, so lookups of cached hostnames don't
+  // wait behind it
+  auto ip = resolve_(hostname);
+  if (!Resolved(ip)) {
+    return ip;
+  }
+  std::scoped_lock lock(mutex_);
+  entries_.try_emplace(hostname, ip, std::chrono::steady_clock::now() + ttl_,
+                       false);
+  if (!refresher_.joinable()) {
+    refresher_ = std::thread([this] { BackgroundRefresh(); });
+  }
+  return ip;
+}
+
+size_t Resolver::size() {
+  std::scoped_lock lock(mutex_);
+  return entries_.size();
+}
+
+void Resolver::BackgroundRefresh() {
+  std::unique_lock lock(mutex_);
+  while (running_) {
+    const auto now = std::chrono::steady_clock::now();
+    auto next = now + ttl_;
+    std::vector<std::string> expired;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      auto& [hostname, entry] = *it;
+      if (entry.expiry > now) {
+        next = std::min(next, entry.expiry);
+        ++it;
+      } else if (!entry.used) {
+        it = entries_.erase(it);
+      } else {
+        expired.push_back(hostname);
+        ++it;
+      }
+    }
+
+    if (expired.empty()) {
+      condition_.wait_until(lock, next);
+      continue;
+    }
+
+    lock.unlock();
+    std::vector<std::pair<std::string, std::string>> refreshed;
+    for (auto& hostname : expired) {
+      auto ip = resolve_(hostname);
+      refreshed.emplace_back(std::move(hostname), std::move(ip));
+    }
+    lock.lock();
+    const auto expiry = std::chrono::steady_clock::now() + ttl_;
+    for (auto& [hostname, ip] : refreshed) {
+      if (auto it = entries_.find(hostname); it != entries_.end()) {
+        if (Resolved(ip)) {
+          it->second.ip = std::move(ip);
+        }
+        it->second.expiry = expiry;
+        it->second.used = false;
+      }
+    }
+  }
+}
@@ -0,0 +1,289 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/constants.h>
+#include <Wink/log.h>
+#include <Wink/ring.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct SharedMemoryRing::Header {
+  // Set once the ring is initialized
+  std::atomic_uint32_t ready;
+  std::atomic_uint32_t closed;
+  std::atomic_uint32_t sleeping;
+  // Process that owns the ring, which may have died without closing it
+  pid_t owner;
+  // Position of the next datagram to pop, only advanced by the owner
+  std::atomic_uint64_t head;
+  // Position of the next datagram to push, only advanced under mutex
+  std::atomic_uint64_t tail;
+  // Serializes pushes from multiple processes
+  pthread_mutex_t mutex;
+};
+
+// Each datagram is preceded by a record, and starts a multiple of
+// kRecordAlignment bytes into the ring
+struct Record {
+  uint32_t length;
+  uint32_t ip;
+  uint16_t port;
+};
+constexpr size_t kRecordAlignment = 8;
+// Marks the rest of the ring as unused, continuing from the start
+constexpr uint32_t kSkip = UINT32_MAX;
+
+constexpr size_t Align(const size_t length) {
+  return (length + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+bool ProcessAlive(const pid_t pid) {
+  // Processes of other users can't be signalled, but do exist
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// Removes the name of a ring whose owner died, unless it already names a ring
+// created since
+void UnlinkOrphan(const std::string& name, const ino_t inode) {
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return;
+  }
+  struct stat status = {};
+  const bool orphan = fstat(fd, &status) == 0 && status.st_ino == inode;
+  close(fd);
+  if (orphan) {
+    shm_unlink(name.c_str());
+  }
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name)
+    : name_(name), owner_(true) {
+  // Close any ring left behind, so its senders reopen this one
+  if (const auto previous = Open(name); previous) {
+    previous->header_->closed = 1;
+  }
+  shm_unlink(name.c_str());
+
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    throw std::runtime_error(std::string("Failed to create shared memory ") +
+                             name + ": " + std::strerror(errno));
+  }
+  const size_t size = sizeof(Header) + kSharedMemoryRingSize;
+  if (ftruncate(fd, size) < 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error(std::string("Failed to size shared memory ") +
+                             name + ": " + std::strerror(errno));
+  }
+  void* mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    throw std::runtime_error(std::string("Failed to map shared memory ") +
+                             name + ": " + std::strerror(errno));
+  }
+  header_ = new (mapping) Header();
+  header_->owner = getpid();
+  data_ = static_cast<char*>(mapping) + sizeof(Header);
+
+  // Mutex is shared between processes, and recovers if a holder dies
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&header_->mutex, &attributes);
+  pthread_mutexattr_destroy(&attributes);
+
+  header_->ready.store(1, std::memory_order_release);
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name, Header* header)
+    : name_(name),
+      owner_(false),
+      header_(header),
+      data_(reinterpret_cast<char*>(header) + sizeof(Header)) {}
+
+SharedMemoryRing::~SharedMemoryRing() {
+  if (owner_) {
+    header_->closed = 1;
+    shm_unlink(name_.c_str());
+  }
+  munmap(header_, sizeof(Header) + kSharedMemoryRingSize);
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Open(
+    const std::string& name) {
+  const int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  // Owner may not have sized the ring yet
+  const size_t size = sizeof(Header) + kSharedMemoryRingSize;
+  struct stat status = {};
+  if (fstat(fd, &status) < 0 || static_cast<size_t>(status.st_size) != size) {
+    close(fd);
+    return nullptr;
+  }
+  void* mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  auto header = static_cast<Header*>(mapping);
+  if (!header->ready.load(std::memory_order_acquire) || header->closed) {
+    munmap(mapping, size);
+    return nullptr;
+  }
+  if (!ProcessAlive(header->owner)) {
+    // Owner crashed, so nobody will pop what is pushed; close the ring for any
+    // senders still holding it, and clean up after the owner
+    header->closed = 1;
+    munmap(mapping, size);
+    UnlinkOrphan(name, status.st_ino);
+    return nullptr;
+  }
+  return std::unique_ptr<SharedMemoryRing>(new SharedMemoryRing(name, header));
+}
+
+bool SharedMemoryRing::Push(const Address& from, const char* buffer,
+                            const size_t length) {
+  if (header_->closed) {
+    return false;
+  }
+  if (length > kMaxUDPPayload) {
+    return false;
+  }
+  const size_t size = Align(sizeof(Record) + length);
+
+  if (const int result = pthread_mutex_lock(&header_->mutex);
+      result == EOWNERDEAD) {
+    // Previous holder died, but positions are only updated once a push is
+    // complete so the ring is still consistent
+    pthread_mutex_consistent(&header_->mutex);
+  } else if (result != 0) {
+    Error() << "Failed to lock shared memory " << name_ << ": "
+            << std::strerror(result) << std::endl;
+    return false;
+  }
+
+  uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+  const uint64_t head = header_->head.load(std::memory_order_acquire);
+  const size_t remaining = kSharedMemoryRingSize - tail % kSharedMemoryRingSize;
+  // Datagrams aren't split across the end of the ring
+  const size_t skip = remaining < size ? remaining : 0;
+  if (tail + skip + size - head > kSharedMemoryRingSize) {
+    pthread_mutex_unlock(&header_->mutex);
+    return false;
+  }
+  if (skip > 0) {
+    if (skip >= sizeof(Record)) {
+      const Record record{kSkip, 0, 0};
+      std::memcpy(data_ + tail % kSharedMemoryRingSize, &record,
+                  sizeof(Record));
+    }
+    tail += skip;
+  }
+
+  sockaddr_in address = {};
+  from.WriteTo(address);
+  const Record record{static_cast<uint32_t>(length), address.sin_addr.s_addr,
+                      address.sin_port};
+  char* position = data_ + tail % kSharedMemoryRingSize;
+  std::memcpy(position, &record, sizeof(Record));
+  std::memcpy(position + sizeof(Record), buffer, length);
+  header_->tail.store(tail + size);
+  pthread_mutex_unlock(&header_->mutex);
+  return true;
+}
+
+size_t SharedMemoryRing::Pop(std::vector<Datagram>& datagrams,
+                             const Address& to) {
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+  size_t count = 0;
+  while (head != tail && count < datagrams.size()) {
+    const size_t remaining =
+        kSharedMemoryRingSize - head % kSharedMemoryRingSize;
+    const char* position = data_ + head % kSharedMemoryRingSize;
+    Record record;
+    if (remaining < sizeof(Record)) {
+      record.length = kSkip;
+    } else {
+      std::memcpy(&record, position, sizeof(Record));
+    }
+    if (record.length == kSkip) {
+      head += remaining;
+      continue;
+    }
+    if (record.length > kMaxUDPPayload ||
+        sizeof(Record) + record.length > remaining ||
+        Align(sizeof(Record) + record.length) > tail - head) {
+      // Record was corrupted, perhaps by a sender that died while writing it,
+      // so nothing after it can be trusted either; close the ring so senders
+      // fall back to UDP
+      Error() << "Corrupt record in shared memory " << name_ << ": "
+              << record.length << " bytes" << std::endl;
+      header_->closed = 1;
+      head = tail;
+      break;
+    }
+
+    auto& d = datagrams[count++];
+    std::memcpy(d.buffer, position + sizeof(Record), record.length);
+    d.length = record.length;
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = record.ip;
+    address.sin_port = record.port;
+    d.from.ReadFrom(address);
+    d.to = to;
+    head += Align(sizeof(Record) + record.length);
+  }
+  header_->head.store(head, std::memory_order_release);
+  return count;
+}
+
+bool SharedMemoryRing::empty() const {
+  return header_->head.load() == header_->tail.load();
+}
+
+bool SharedMemoryRing::closed() const { return header_->closed; }
+
+bool SharedMemoryRing::alive() {
+  if (header_->closed) {
+    return false;
+  }
+  if (!owner_ && !ProcessAlive(header_->owner)) {
+    header_->closed = 1;
+    return false;
+  }
+  return true;
+}
+
+bool SharedMemoryRing::Sleep() {
+  header_->sleeping.store(1);
+  if (!empty()) {
+    header_->sleeping.store(0);
+    return false;
+  }
+  return true;
+}
+
+void SharedMemoryRing::Awake() { header_->sleeping.store(0); }
+
+bool SharedMemoryRing::Wake() { return header_->sleeping.exchange(0) == 1; }
@@ -0,0 +1,30 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/rtt.h>
+
+#include <algorithm>
+
+void RoundTrip::Sample(const std::chrono::microseconds rtt) {
+  if (samples_ == 0) {
+    smoothed_ = rtt;
+    variance_ = rtt / 2;
+  } else {
+    // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|
+    const auto error = smoothed_ > rtt ? smoothed_ - rtt : rtt - smoothed_;
+    variance_ = (3 * variance_ + error) / 4;
+    // SRTT = 7/8 SRTT + 1/8 R
+    smoothed_ = (7 * smoothed_ + rtt) / 8;
+  }
+  samples_++;
+  // RTO = SRTT + 4 RTTVAR
+  const std::chrono::microseconds timeout = smoothed_ + 4 * variance_;
+  timeout_ = std::clamp<std::chrono::microseconds>(
+      timeout, kMinRetransmitTimeout, kMaxRetransmitTimeout);
+}
+
+std::chrono::microseconds RoundTrip::Timeout(const uint8_t attempts) const {
+  auto timeout = timeout_;
+  for (uint8_t i = 1; i < attempts && timeout < kMaxRetransmitTimeout; i++) {
+    timeout *= 2;
+  }
+  return std::min<std::chrono::microseconds>(timeout, kMaxRetransmitTimeout);
+}
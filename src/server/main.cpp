@@ -2,6 +2,7 @@
 #include <WinkServer/server.h>
 
 #include <map>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -25,6 +26,9 @@ void Help(std::string name, std::string command) {
            << kServerPort << ')' << std::endl;
     Info() << "\t-l" << std::endl;
     Info() << "\t\tThe directory to log to (default disabled)" << std::endl;
+    Info() << "\t-s" << std::endl;
+    Info() << "\t\tThe number of threads receiving on the address (default 1)"
+           << std::endl;
     Info() << "Parameters;" << std::endl;
     Info() << "\tdirectory" << std::endl;
     Info() << "\t\tThe directory containing machine binaries" << std::endl;
@@ -61,6 +65,7 @@ int main(int argc, char** argv) {
   if (command == "serve") {
     Address address(kLocalhost, kServerPort);
     std::string log;
+    size_t shards = 1;
 
     if (parameters.size() == 0) {
       Error() << "Missing <directory> parameter" << std::endl;
@@ -71,15 +76,23 @@ int main(int argc, char** argv) {
     for (const auto& [k, v] : options) {
       if (k == "-a") {
         std::stringstream ss(v);
-        ss >> address;
+        try {
+          ss >> address;
+        } catch (const std::logic_error& e) {
+          Error() << "Invalid address " << v << ": " << e.what() << std::endl;
+          return -1;
+        }
       } else if (k == "-l") {
         log = v;
+      } else if (k == "-s") {
+        std::stringstream ss(v);
+        ss >> shards;
       } else {
         Error() << "Option " << k << ":" << v << " not supported" << std::endl;
       }
     }
 
-    UDPSocket socket(address);
+    UDPSocket socket(address, shards);
     AsyncMailbox mailbox(socket);
     Server s(address, mailbox, log);
     return s.Serve(parameters.at(0));
@@ -1,6 +1,7 @@
 // Copyright 2022-2025 Stuart Scott
 #include <WinkServer/server.h>
 
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -36,7 +37,15 @@ int Server::Serve(const std::string& directory) {
       Address destination;
       // start <name> <port>
       if (iss.good()) {
-        iss >> destination;
+        // Messages come from anyone, so an unparsable address mustn't bring
+        // down the server
+        try {
+          iss >> destination;
+        } catch (const std::logic_error& e) {
+          Error() << "Invalid address from " << from << ": " << message << ": "
+                  << e.what() << std::endl;
+          continue;
+        }
       }
       destination.set_ip(address_.ip());
 
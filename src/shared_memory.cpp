@@ -0,0 +1,146 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/ring.h>
+#include <Wink/socket.h>
+
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+std::string RingName(const Address& address) {
+  return "/wink-" + address.ip() + "-" + std::to_string(address.port());
+}
+
+SharedMemorySocket::SharedMemorySocket(Address& address)
+    : UDPSocket(address),
+      inbox_(std::make_unique<SharedMemoryRing>(RingName(address_))) {}
+
+SharedMemorySocket::~SharedMemorySocket() {}
+
+bool SharedMemorySocket::Receive(Address& from, Address& to, char* buffer,
+                                 size_t& length) {
+  std::vector<Datagram> datagrams(1);
+  datagrams[0].buffer = buffer;
+  if (inbox_->Pop(datagrams, address_) == 0) {
+    return UDPSocket::Receive(from, to, buffer, length);
+  }
+  from = datagrams[0].from;
+  to = datagrams[0].to;
+  length = datagrams[0].length;
+  return true;
+}
+
+bool SharedMemorySocket::Send(const Address& to, const char* buffer,
+                              const size_t length) {
+  switch (SendRing(to, buffer, length)) {
+    case Delivery::kSent:
+      return true;
+    case Delivery::kBusy:
+      // Sending over the network would overtake the datagrams in the ring, so
+      // report the failure, and leave it to be sent again
+      return false;
+    case Delivery::kUnreachable:
+      break;
+  }
+  return UDPSocket::Send(to, buffer, length);
+}
+
+size_t SharedMemorySocket::ReceiveBatch(std::vector<Datagram>& datagrams) {
+  // Take whatever the network has without waiting, so a busy ring can't starve
+  // it
+  if (const auto count =
+          UDPSocket::ReceiveBatch(datagrams, std::chrono::milliseconds(0));
+      count > 0) {
+    return count;
+  }
+  if (const auto count = inbox_->Pop(datagrams, address_); count > 0) {
+    return count;
+  }
+  // Wait on the network, senders will ring the doorbell if they push to the
+  // ring in the meantime
+  if (inbox_->Sleep()) {
+    const auto count = UDPSocket::ReceiveBatch(datagrams);
+    inbox_->Awake();
+    if (count > 0) {
+      return count;
+    }
+  }
+  return inbox_->Pop(datagrams, address_);
+}
+
+size_t SharedMemorySocket::SendBatch(const std::vector<Datagram>& datagrams,
+                                     const size_t count) {
+  size_t sent = 0;
+  std::vector<Datagram> remote;
+  // Peers with a full ring, whose remaining datagrams in the batch are held
+  // back to keep them in order
+  std::set<Address> busy;
+  for (size_t i = 0; i < count && i < datagrams.size(); i++) {
+    const auto& d = datagrams[i];
+    if (busy.count(d.to) > 0) {
+      continue;
+    }
+    switch (SendRing(d.to, d.buffer, d.length)) {
+      case Delivery::kSent:
+        sent++;
+        break;
+      case Delivery::kBusy:
+        busy.insert(d.to);
+        break;
+      case Delivery::kUnreachable:
+        remote.push_back(d);
+        break;
+    }
+  }
+  if (!remote.empty()) {
+    sent += UDPSocket::SendBatch(remote, remote.size());
+  }
+  return sent;
+}
+
+Delivery SharedMemorySocket::SendRing(const Address& to, const char* buffer,
+                                      const size_t length) {
+  if (to.IsMulticast() || length > kMaxUDPPayload) {
+    return Delivery::kUnreachable;
+  }
+  std::scoped_lock lock(peers_mutex_);
+  auto& peer = peers_[to];
+  const auto now = std::chrono::steady_clock::now();
+  if (peer.ring && now >= peer.retry) {
+    // Check now and then that the owner hasn't crashed without closing the
+    // ring, leaving its port to a process that may not use shared memory
+    peer.retry = now + kSendTimeout;
+    peer.ring->alive();
+  }
+  if (peer.ring && peer.ring->closed()) {
+    // Peer has gone, it may have been replaced
+    peer.ring.reset();
+    peer.retry = now;
+  }
+  if (!peer.ring) {
+    if (now < peer.retry) {
+      return Delivery::kUnreachable;
+    }
+    peer.retry = now + kSendTimeout;
+    peer.ring = SharedMemoryRing::Open(RingName(to));
+    if (!peer.ring) {
+      // Peer is remote, or not using shared memory
+      return Delivery::kUnreachable;
+    }
+  }
+  if (!peer.ring->Push(address_, buffer, length)) {
+    if (!peer.ring->alive()) {
+      peer.ring.reset();
+      return Delivery::kUnreachable;
+    }
+    // Ring is full, until the peer catches up
+    return Delivery::kBusy;
+  }
+  if (peer.ring->Wake()) {
+    // Peer is waiting on the network, so ring the doorbell with an empty
+    // datagram
+    UDPSocket::Send(to, nullptr, 0);
+  }
+  return Delivery::kSent;
+}
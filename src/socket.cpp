@@ -0,0 +1,33 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/socket.h>
+
+#include <vector>
+
+size_t Socket::ReceiveBatch(std::vector<Datagram>& datagrams) {
+  if (datagrams.empty()) {
+    return 0;
+  }
+  auto& d = datagrams.front();
+  if (!Receive(d.from, d.to, d.buffer, d.length) &&
+      !ReceiveMulticast(d.from, d.to, d.buffer, d.length)) {
+    return 0;
+  }
+  return 1;
+}
+
+size_t Socket::SendBatch(const std::vector<Datagram>& datagrams,
+                         const size_t count) {
+  size_t sent = 0;
+  for (size_t i = 0; i < count && i < datagrams.size(); i++) {
+    const auto& d = datagrams[i];
+    if (Send(d.to, d.buffer, d.length)) {
+      sent++;
+    }
+  }
+  return sent;
+}
+
+size_t Socket::ReceiveShard(std::vector<Datagram>& datagrams,
+                            const size_t shard) {
+  return ReceiveBatch(datagrams);
+}
@@ -1,14 +1,69 @@
 // Copyright 2022-2025 Stuart Scott
 #include <Wink/log.h>
 #include <Wink/socket.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <sys/epoll.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <deque>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
-UDPSocket::UDPSocket(Address& address)
+// Room for the segment size of a coalesced datagram
+constexpr size_t kControlSize = CMSG_SPACE(sizeof(int));
+
+// Returns the size of each segment of a coalesced datagram, or 0 if the
+// datagram wasn't coalesced
+size_t SegmentSize(msghdr& header) {
+  for (auto c = CMSG_FIRSTHDR(&header); c; c = CMSG_NXTHDR(&header, c)) {
+    if (c->cmsg_level == IPPROTO_UDP && c->cmsg_type == UDP_GRO) {
+      int size;
+      std::memcpy(&size, CMSG_DATA(c), sizeof(int));
+      return size;
+    }
+  }
+  return 0;
+}
+
+// Opens another socket bound to the given address, which must already be bound
+// with SO_REUSEPORT
+int OpenShard(const Address& address) {
+  const int shard_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (shard_socket < 0) {
+    throw std::runtime_error(std::string("Failed to open UDP shard socket: ") +
+                             std::strerror(errno));
+  }
+  auto on = 1;
+  if (setsockopt(shard_socket, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(int)) <
+      0) {
+    close(shard_socket);
+    throw std::runtime_error(
+        std::string("Failed to set UDP shard socket reuse option: ") +
+        std::strerror(errno));
+  }
+  sockaddr_in shard_address = {};
+  address.WriteTo(shard_address);
+  if (bind(shard_socket, (struct sockaddr*)&shard_address,
+           sizeof(struct sockaddr_in)) < 0) {
+    close(shard_socket);
+    throw std::runtime_error(
+        std::string("Failed to bind UDP shard socket to ") +
+        address.ToString() + std::string(": ") + std::strerror(errno));
+  }
+  setsockopt(shard_socket, IPPROTO_UDP, UDP_GRO, &on, sizeof(int));
+  return shard_socket;
+}
+
+UDPSocket::UDPSocket(Address& address, const size_t shards)
     : address_(address),
-      unicast_socket_(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) {
+      unicast_socket_(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)),
+      segments_(std::max<size_t>(shards, 1)) {
   if (unicast_socket_ < 0) {
     throw std::runtime_error(
         std::string("Failed to open UDP unicast socket: ") +
@@ -24,6 +79,14 @@ UDPSocket::UDPSocket(Address& address)
         std::strerror(errno));
   }
 
+  // Let the shards bind to the same address
+  if (shards > 1 && setsockopt(unicast_socket_, SOL_SOCKET, SO_REUSEPORT, &on,
+                               sizeof(int)) < 0) {
+    throw std::runtime_error(
+        std::string("Failed to set UDP unicast socket port reuse option: ") +
+        std::strerror(errno));
+  }
+
   // Bind unicast socket
   sockaddr_in unicast_address = {};
   address.WriteTo(unicast_address);
@@ -66,14 +129,58 @@ UDPSocket::UDPSocket(Address& address)
         std::string("Failed to set UDP unicast socket multicast interace: ") +
         std::strerror(errno));
   }
+
+  // Receive datagrams coalesced by the sender or network card, which are split
+  // back up on receipt. Older kernels can't, and deliver them as sent
+  setsockopt(unicast_socket_, IPPROTO_UDP, UDP_GRO, &on, sizeof(int));
+
+  // Watch unicast socket for incoming packets
+  epoll_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_ < 0) {
+    throw std::runtime_error(std::string("Failed to create epoll instance: ") +
+                             std::strerror(errno));
+  }
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = unicast_socket_;
+  if (epoll_ctl(epoll_, EPOLL_CTL_ADD, unicast_socket_, &event) < 0) {
+    throw std::runtime_error(
+        std::string("Failed to watch UDP unicast socket: ") +
+        std::strerror(errno));
+  }
+
+  // Open the remaining shards on the assigned address
+  for (size_t i = 1; i < shards; i++) {
+    shard_sockets_.push_back(OpenShard(address));
+  }
 }
 
 bool UDPSocket::Receive(Address& from, Address& to, char* buffer,
                         size_t& length) {
+  {
+    std::scoped_lock lock(segments_mutex_);
+    if (auto& segments = segments_.front(); !segments.empty()) {
+      auto& segment = segments.front();
+      from = segment.from;
+      to = segment.to;
+      length = segment.payload.length();
+      std::memcpy(buffer, segment.payload.data(), length);
+      segments.pop_front();
+      return true;
+    }
+  }
+
   sockaddr_in address = {};
-  socklen_t size = sizeof(struct sockaddr_in);
-  const ssize_t result = recvfrom(unicast_socket_, buffer, kMaxUDPPayload, 0,
-                                  (struct sockaddr*)&address, &size);
+  iovec iov = {buffer, kMaxUDPPayload};
+  char control[kControlSize];
+  msghdr header = {};
+  header.msg_name = &address;
+  header.msg_namelen = sizeof(struct sockaddr_in);
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  header.msg_control = control;
+  header.msg_controllen = kControlSize;
+  const ssize_t result = recvmsg(unicast_socket_, &header, 0);
   if (result <= 0) {
     if (errno != EAGAIN) {
       Error() << "Failed to receive unicast packet: " << std::strerror(errno)
@@ -84,16 +191,29 @@ bool UDPSocket::Receive(Address& from, Address& to, char* buffer,
   from.ReadFrom(address);
   to = address_;
   length = result;
+
+  // Keep the rest of a coalesced datagram for the next receive
+  if (const auto size = SegmentSize(header); size > 0 && length > size) {
+    std::scoped_lock lock(segments_mutex_);
+    for (size_t o = size; o < length; o += size) {
+      const auto segment = std::min(size, length - o);
+      segments_.front().emplace_back(from, to,
+                                     std::string(buffer + o, segment));
+    }
+    length = size;
+  }
   return true;
 }
 
 bool UDPSocket::ReceiveMulticast(Address& from, Address& to, char* buffer,
                                  size_t& length) {
+  std::scoped_lock lock(multicast_mutex_);
   for (const auto& [group, multicast_socket] : multicast_sockets_) {
     sockaddr_in address = {};
     socklen_t size = sizeof(struct sockaddr_in);
-    const ssize_t result = recvfrom(multicast_socket, buffer, kMaxUDPPayload, 0,
-                                    (struct sockaddr*)&address, &size);
+    const ssize_t result =
+        recvfrom(multicast_socket, buffer, kMaxUDPPayload, MSG_DONTWAIT,
+                 (struct sockaddr*)&address, &size);
     if (result <= 0) {
       if (errno != EAGAIN) {
         Error() << "Failed to receive multicast packet from " << group << ": "
@@ -120,6 +240,297 @@ bool UDPSocket::Send(const Address& to, const char* buffer,
   return result >= 0;
 }
 
+size_t UDPSocket::ReceiveBatch(std::vector<Datagram>& datagrams) {
+  return ReceiveBatch(datagrams, kReceiveTimeout);
+}
+
+size_t UDPSocket::ReceiveBatch(std::vector<Datagram>& datagrams,
+                               const std::chrono::milliseconds timeout) {
+  // Finish delivering coalesced datagrams before receiving more
+  if (const auto received = ReceiveSegments(0, datagrams); received > 0) {
+    return received;
+  }
+
+  // Wait until any of the sockets has packets
+  epoll_event events[kMaxBatchSize];
+  const int ready =
+      epoll_wait(epoll_, events, kMaxBatchSize, timeout.count());
+  if (ready < 0) {
+    if (errno != EINTR) {
+      Error() << "Failed to wait for packets: " << std::strerror(errno)
+              << std::endl;
+    }
+    return 0;
+  }
+
+  size_t received = 0;
+  for (int i = 0; i < ready && received < datagrams.size(); i++) {
+    const int s = events[i].data.fd;
+    if (s == unicast_socket_) {
+      received += ReceiveBatch(s, 0, address_, datagrams, received);
+      continue;
+    }
+    std::scoped_lock lock(multicast_mutex_);
+    if (const auto it = multicast_groups_.find(s);
+        it != multicast_groups_.end()) {
+      received += ReceiveBatch(s, 0, it->second, datagrams, received);
+    }
+  }
+  return received;
+}
+
+bool UDPSocket::Self(const Address& to) {
+  if (to.port() != address_.port()) {
+    return false;
+  }
+  // A socket bound to every interface is reached through loopback too
+  return to.ToInetAddr() == address_.ToInetAddr() ||
+         (address_.ToInetAddr() == INADDR_ANY &&
+          (ntohl(to.ToInetAddr()) >> IN_CLASSA_NSHIFT) == IN_LOOPBACKNET);
+}
+
+size_t UDPSocket::Shards() { return 1 + shard_sockets_.size(); }
+
+size_t UDPSocket::ReceiveShard(std::vector<Datagram>& datagrams,
+                               const size_t shard) {
+  if (shard == 0) {
+    return ReceiveBatch(datagrams);
+  }
+  if (const auto received = ReceiveSegments(shard, datagrams); received > 0) {
+    return received;
+  }
+  pollfd ready = {shard_sockets_.at(shard - 1), POLLIN, 0};
+  const int timeout =
+      std::chrono::duration_cast<std::chrono::milliseconds>(kReceiveTimeout)
+          .count();
+  if (const auto result = poll(&ready, 1, timeout); result <= 0) {
+    if (result < 0 && errno != EINTR) {
+      Error() << "Failed to wait for packets: " << std::strerror(errno)
+              << std::endl;
+    }
+    return 0;
+  }
+  return ReceiveBatch(ready.fd, shard, address_, datagrams, 0);
+}
+
+bool UDPSocket::Watch(const int socket) {
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = socket;
+  if (epoll_ctl(epoll_, EPOLL_CTL_ADD, socket, &event) < 0) {
+    Error() << "Failed to watch socket: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool UDPSocket::Unwatch(const int socket) {
+  if (epoll_ctl(epoll_, EPOLL_CTL_DEL, socket, nullptr) < 0) {
+    Error() << "Failed to unwatch socket: " << std::strerror(errno)
+            << std::endl;
+    return false;
+  }
+  return true;
+}
+
+size_t UDPSocket::ReceiveSegments(const size_t shard,
+                                  std::vector<Datagram>& datagrams) {
+  std::scoped_lock lock(segments_mutex_);
+  auto& segments = segments_[shard];
+  size_t received = 0;
+  while (!segments.empty() && received < datagrams.size()) {
+    auto& segment = segments.front();
+    auto& d = datagrams[received++];
+    d.from = segment.from;
+    d.to = segment.to;
+    d.length = segment.payload.length();
+    std::memcpy(d.buffer, segment.payload.data(), d.length);
+    segments.pop_front();
+  }
+  return received;
+}
+
+size_t UDPSocket::ReceiveBatch(const int socket, const size_t shard,
+                               const Address& to,
+                               std::vector<Datagram>& datagrams,
+                               const size_t offset) {
+  const auto count = datagrams.size() - offset;
+  std::vector<sockaddr_in> addresses(count);
+  std::vector<iovec> iovecs(count);
+  std::vector<char> controls(count * kControlSize);
+  std::vector<mmsghdr> headers(count);
+  for (size_t i = 0; i < count; i++) {
+    iovecs[i].iov_base = datagrams[offset + i].buffer;
+    iovecs[i].iov_len = kMaxUDPPayload;
+    headers[i].msg_hdr.msg_name = &addresses[i];
+    headers[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    headers[i].msg_hdr.msg_iov = &iovecs[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+    headers[i].msg_hdr.msg_control = &controls[i * kControlSize];
+    headers[i].msg_hdr.msg_controllen = kControlSize;
+  }
+
+  // Socket is ready, so take whatever is queued without blocking
+  const int result =
+      recvmmsg(socket, headers.data(), count, MSG_DONTWAIT, nullptr);
+  if (result <= 0) {
+    if (result < 0 && errno != EAGAIN) {
+      Error() << "Failed to receive packets for " << to << ": "
+              << std::strerror(errno) << std::endl;
+    }
+    return 0;
+  }
+  size_t received = 0;
+  size_t segments = 0;
+  std::vector<size_t> sizes(result);
+  for (int i = 0; i < result; i++) {
+    if (headers[i].msg_len == 0) {
+      continue;
+    }
+    auto& d = datagrams[offset + received];
+    if (static_cast<size_t>(i) != received) {
+      std::swap(d.buffer, datagrams[offset + i].buffer);
+    }
+    d.from.ReadFrom(addresses[i]);
+    d.to = to;
+    d.length = headers[i].msg_len;
+    const auto size = SegmentSize(headers[i].msg_hdr);
+    sizes[received] = size > 0 && d.length > size ? size : d.length;
+    segments += (d.length + sizes[received] - 1) / sizes[received];
+    received++;
+  }
+  if (segments == received) {
+    return received;
+  }
+
+  // Split coalesced datagrams, working back from the last so each segment is
+  // copied over a datagram that has already been split. Segments beyond the
+  // batch are kept for the next receive
+  std::deque<Segment> overflow;
+  size_t position = offset + segments;
+  for (size_t i = received; i-- > 0;) {
+    const auto& d = datagrams[offset + i];
+    const auto size = sizes[i];
+    for (size_t o = ((d.length - 1) / size) * size;; o -= size) {
+      const auto length = std::min(size, d.length - o);
+      if (--position >= datagrams.size()) {
+        overflow.emplace_front(d.from, to, std::string(d.buffer + o, length));
+      } else if (position != offset + i) {
+        auto& segment = datagrams[position];
+        std::memcpy(segment.buffer, d.buffer + o, length);
+        segment.from = d.from;
+        segment.to = to;
+        segment.length = length;
+      }
+      if (o == 0) {
+        break;
+      }
+    }
+    datagrams[offset + i].length = std::min(size, d.length);
+  }
+  if (!overflow.empty()) {
+    std::scoped_lock lock(segments_mutex_);
+    auto& segments = segments_[shard];
+    segments.insert(segments.end(), overflow.begin(), overflow.end());
+  }
+  return std::min(segments, datagrams.size() - offset);
+}
+
+size_t UDPSocket::SendBatch(const std::vector<Datagram>& datagrams,
+                            const size_t count) {
+  std::vector<sockaddr_in> addresses(count);
+  std::vector<iovec> iovecs(count);
+  for (size_t i = 0; i < count; i++) {
+    datagrams[i].to.WriteTo(addresses[i]);
+    iovecs[i].iov_base = datagrams[i].buffer;
+    iovecs[i].iov_len = datagrams[i].length;
+  }
+
+  // Coalesce consecutive datagrams to the same peer into one, which the kernel
+  // or network card segments back into datagrams of the size of the first. All
+  // but the last must be that size
+  std::vector<char> controls(count * kControlSize);
+  std::vector<mmsghdr> headers;
+  std::vector<size_t> firsts;
+  const bool segmentation = segmentation_;
+  for (size_t i = 0; i < count;) {
+    const auto size = iovecs[i].iov_len;
+    size_t length = size;
+    size_t j = i + 1;
+    if (segmentation && size > 0 && size <= kMaxSegmentSize) {
+      while (j < count && j - i < kMaxSegments &&
+             addresses[j].sin_addr.s_addr == addresses[i].sin_addr.s_addr &&
+             addresses[j].sin_port == addresses[i].sin_port &&
+             iovecs[j].iov_len > 0 && iovecs[j].iov_len <= size &&
+             length + iovecs[j].iov_len <= kMaxUDPPayload) {
+        length += iovecs[j].iov_len;
+        if (iovecs[j++].iov_len < size) {
+          break;
+        }
+      }
+    }
+    mmsghdr header = {};
+    header.msg_hdr.msg_name = &addresses[i];
+    header.msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    header.msg_hdr.msg_iov = &iovecs[i];
+    header.msg_hdr.msg_iovlen = j - i;
+    if (j - i > 1) {
+      header.msg_hdr.msg_control = &controls[i * kControlSize];
+      header.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+      auto c = CMSG_FIRSTHDR(&header.msg_hdr);
+      c->cmsg_level = IPPROTO_UDP;
+      c->cmsg_type = UDP_SEGMENT;
+      c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      const uint16_t segment = size;
+      std::memcpy(CMSG_DATA(c), &segment, sizeof(uint16_t));
+    }
+    headers.push_back(header);
+    firsts.push_back(i);
+    i = j;
+  }
+  firsts.push_back(count);
+
+  std::scoped_lock send_lock(send_mutex_);
+  size_t sent = 0;
+  size_t offset = 0;
+  while (offset < headers.size()) {
+    const int result = sendmmsg(unicast_socket_, headers.data() + offset,
+                                headers.size() - offset, 0);
+    if (result >= 0) {
+      sent += firsts[offset + result] - firsts[offset];
+      offset += result;
+      continue;
+    }
+    const auto first = firsts[offset];
+    const auto last = firsts[offset + 1];
+    if (last - first > 1) {
+      // Segmentation isn't supported, so send the datagrams separately from
+      // now on
+      if (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT ||
+          errno == EOPNOTSUPP) {
+        if (segmentation_.exchange(false)) {
+          Info() << "Failed to send coalesced packets: "
+                 << std::strerror(errno) << ", sending separately"
+                 << std::endl;
+        }
+      }
+      for (size_t i = first; i < last; i++) {
+        if (sendto(unicast_socket_, iovecs[i].iov_base, iovecs[i].iov_len, 0,
+                   (struct sockaddr*)&addresses[i],
+                   sizeof(struct sockaddr_in)) >= 0) {
+          sent++;
+        }
+      }
+    } else {
+      // Skip the datagram that failed and carry on with the rest
+      Error() << "Failed to send unicast packet to " << datagrams[first].to
+              << ": " << std::strerror(errno) << std::endl;
+    }
+    offset++;
+  }
+  return sent;
+}
+
 bool UDPSocket::JoinGroup(const Address& group) {
   if (!group.IsMulticast()) {
     Error() << "IP is not a multicast group: " << group.ip() << std::endl;
@@ -158,18 +569,6 @@ bool UDPSocket::JoinGroup(const Address& group) {
     return false;
   }
 
-  // Set receive timeout on unicast socket
-  timeval tv = {};
-  tv.tv_sec = kReceiveTimeout.count();
-  tv.tv_usec = 0;
-  if (setsockopt(multicast_socket, SOL_SOCKET, SO_RCVTIMEO, &tv,
-                 sizeof(struct timeval)) < 0) {
-    Error() << "Failed to set UDP multicast socket receive timeout: "
-            << std::strerror(errno) << std::endl;
-    close(multicast_socket);
-    return false;
-  }
-
   // Join multicast group
   ip_mreq group_address = {};
   group_address.imr_multiaddr.s_addr = group.ToInetAddr();
@@ -182,15 +581,36 @@ bool UDPSocket::JoinGroup(const Address& group) {
     return false;
   }
 
+  // Watch multicast socket for incoming packets
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = multicast_socket;
+  if (epoll_ctl(epoll_, EPOLL_CTL_ADD, multicast_socket, &event) < 0) {
+    Error() << "Failed to watch UDP multicast socket: " << std::strerror(errno)
+            << std::endl;
+    close(multicast_socket);
+    return false;
+  }
+
+  std::scoped_lock lock(multicast_mutex_);
   multicast_sockets_[group] = multicast_socket;
+  multicast_groups_[multicast_socket] = group;
   return true;
 }
 
 bool UDPSocket::LeaveGroup(const Address& group) {
+  std::scoped_lock lock(multicast_mutex_);
   if (const auto it = multicast_sockets_.find(group);
       it != multicast_sockets_.end()) {
     const auto multicast_socket = it->second;
     multicast_sockets_.erase(it);
+    multicast_groups_.erase(multicast_socket);
+
+    // Stop watching multicast socket
+    if (epoll_ctl(epoll_, EPOLL_CTL_DEL, multicast_socket, nullptr) < 0) {
+      Error() << "Failed to unwatch UDP multicast socket: "
+              << std::strerror(errno) << std::endl;
+    }
 
     // Leave multicast group
     ip_mreq group_address = {};
@@ -0,0 +1,269 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/constants.h>
+#include <Wink/log.h>
+#include <Wink/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Unix sockets are bound in the runtime directory, named after the UDP address
+// of their owner
+std::string UnixDirectory() {
+  const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+  return std::string(runtime ? runtime : "/tmp") + "/wink";
+}
+
+std::string UnixPath(const Address& address) {
+  sockaddr_in inet = {};
+  address.WriteTo(inet);
+  char ip[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &inet.sin_addr, ip, INET_ADDRSTRLEN);
+  return UnixDirectory() + "/" + ip + "-" + std::to_string(address.port());
+}
+
+bool UnixAddress(const sockaddr_un& unix_address, const socklen_t size,
+                 Address& address) {
+  if (size <= offsetof(sockaddr_un, sun_path)) {
+    // Sender is unbound
+    return false;
+  }
+  // Paths are named by other processes, so parse them strictly, and never
+  // resolve them
+  const std::string path(unix_address.sun_path);
+  const auto slash = path.rfind('/');
+  const auto dash = path.rfind('-');
+  if (slash == std::string::npos || dash == std::string::npos ||
+      dash < slash) {
+    return false;
+  }
+  sockaddr_in inet = {};
+  inet.sin_family = AF_INET;
+  const auto ip = path.substr(slash + 1, dash - slash - 1);
+  if (inet_pton(AF_INET, ip.c_str(), &inet.sin_addr) != 1) {
+    return false;
+  }
+  const auto begin = path.data() + dash + 1;
+  const auto end = path.data() + path.length();
+  uint16_t port = 0;
+  if (const auto [p, error] = std::from_chars(begin, end, port);
+      begin == end || error != std::errc() || p != end) {
+    return false;
+  }
+  inet.sin_port = htons(port);
+  address.ReadFrom(inet);
+  return true;
+}
+
+UnixSocket::UnixSocket(Address& address)
+    : UDPSocket(address),
+      path_(UnixPath(address_)),
+      local_socket_(socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) {
+  if (local_socket_ < 0) {
+    throw std::runtime_error(std::string("Failed to open Unix socket: ") +
+                             std::strerror(errno));
+  }
+
+  if (mkdir(UnixDirectory().c_str(), 0700) < 0 && errno != EEXIST) {
+    close(local_socket_);
+    throw std::runtime_error(std::string("Failed to create directory ") +
+                             UnixDirectory() + ": " + std::strerror(errno));
+  }
+
+  // Bind Unix socket, replacing any left behind by a previous owner
+  sockaddr_un local_address = {};
+  local_address.sun_family = AF_UNIX;
+  if (path_.length() >= sizeof(local_address.sun_path)) {
+    close(local_socket_);
+    throw std::runtime_error(std::string("Unix socket path too long: ") +
+                             path_);
+  }
+  std::strncpy(local_address.sun_path, path_.c_str(),
+               sizeof(local_address.sun_path) - 1);
+  unlink(path_.c_str());
+  if (bind(local_socket_, (struct sockaddr*)&local_address,
+           sizeof(struct sockaddr_un)) < 0) {
+    close(local_socket_);
+    throw std::runtime_error(std::string("Failed to bind Unix socket to ") +
+                             path_ + ": " + std::strerror(errno));
+  }
+
+  // Wake ReceiveBatch when the Unix socket has datagrams
+  if (!Watch(local_socket_)) {
+    close(local_socket_);
+    unlink(path_.c_str());
+    throw std::runtime_error("Failed to watch Unix socket");
+  }
+}
+
+UnixSocket::~UnixSocket() {
+  close(local_socket_);
+  unlink(path_.c_str());
+}
+
+bool UnixSocket::Receive(Address& from, Address& to, char* buffer,
+                         size_t& length) {
+  std::vector<Datagram> datagrams(1);
+  datagrams[0].buffer = buffer;
+  if (ReceiveLocal(datagrams) == 0) {
+    return UDPSocket::Receive(from, to, buffer, length);
+  }
+  from = datagrams[0].from;
+  to = datagrams[0].to;
+  length = datagrams[0].length;
+  return true;
+}
+
+bool UnixSocket::Send(const Address& to, const char* buffer,
+                      const size_t length) {
+  if (Reliable(to)) {
+    return SendLocal(to, buffer, length) == Delivery::kSent;
+  }
+  return UDPSocket::Send(to, buffer, length);
+}
+
+size_t UnixSocket::ReceiveBatch(std::vector<Datagram>& datagrams) {
+  // Take whatever the network has without waiting, so a busy Unix socket can't
+  // starve it
+  if (const auto count =
+          UDPSocket::ReceiveBatch(datagrams, std::chrono::milliseconds(0));
+      count > 0) {
+    return count;
+  }
+  if (const auto count = ReceiveLocal(datagrams); count > 0) {
+    return count;
+  }
+  // Wait on both, the Unix socket is watched but left for us to receive
+  if (const auto count = UDPSocket::ReceiveBatch(datagrams); count > 0) {
+    return count;
+  }
+  return ReceiveLocal(datagrams);
+}
+
+size_t UnixSocket::SendBatch(const std::vector<Datagram>& datagrams,
+                             const size_t count) {
+  size_t sent = 0;
+  std::vector<Datagram> remote;
+  for (size_t i = 0; i < count && i < datagrams.size(); i++) {
+    const auto& d = datagrams[i];
+    if (!Reliable(d.to)) {
+      remote.push_back(d);
+    } else if (SendLocal(d.to, d.buffer, d.length) == Delivery::kSent) {
+      sent++;
+    }
+  }
+  if (!remote.empty()) {
+    sent += UDPSocket::SendBatch(remote, remote.size());
+  }
+  return sent;
+}
+
+bool UnixSocket::Reliable(const Address& to) {
+  if (to.IsMulticast()) {
+    return false;
+  }
+  std::scoped_lock lock(peers_mutex_);
+  if (const auto it = peers_.find(to); it != peers_.end()) {
+    return it->second;
+  }
+  // Probe with an empty datagram, which fails if no socket is bound to the
+  // peer's path, or the socket was left behind by a process that has gone
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, UnixPath(to).c_str(),
+               sizeof(address.sun_path) - 1);
+  const bool local =
+      sendto(local_socket_, nullptr, 0, MSG_DONTWAIT,
+             (struct sockaddr*)&address, sizeof(struct sockaddr_un)) >= 0 ||
+      errno == EAGAIN;
+  peers_[to] = local;
+  return local;
+}
+
+Delivery UnixSocket::SendReliable(const Address& to, const char* buffer,
+                                  const size_t length) {
+  return SendLocal(to, buffer, length);
+}
+
+size_t UnixSocket::ReceiveLocal(std::vector<Datagram>& datagrams) {
+  const auto count = datagrams.size();
+  std::vector<sockaddr_un> addresses(count);
+  std::vector<iovec> iovecs(count);
+  std::vector<mmsghdr> headers(count);
+  for (size_t i = 0; i < count; i++) {
+    iovecs[i].iov_base = datagrams[i].buffer;
+    iovecs[i].iov_len = kMaxUDPPayload;
+    headers[i].msg_hdr.msg_name = &addresses[i];
+    headers[i].msg_hdr.msg_iov = &iovecs[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // Carry on past probes, so they don't hide the datagrams behind them
+  while (true) {
+    for (auto& header : headers) {
+      header.msg_hdr.msg_namelen = sizeof(struct sockaddr_un);
+    }
+    const int result =
+        recvmmsg(local_socket_, headers.data(), count, MSG_DONTWAIT, nullptr);
+    if (result <= 0) {
+      if (result < 0 && errno != EAGAIN) {
+        Error() << "Failed to receive Unix datagrams: " << std::strerror(errno)
+                << std::endl;
+      }
+      return 0;
+    }
+    size_t received = 0;
+    for (int i = 0; i < result; i++) {
+      if (headers[i].msg_len == 0) {
+        continue;
+      }
+      auto& d = datagrams[received];
+      if (!UnixAddress(addresses[i], headers[i].msg_hdr.msg_namelen,
+                       d.from)) {
+        Error() << "Dropping Unix datagram from unknown sender" << std::endl;
+        continue;
+      }
+      if (static_cast<size_t>(i) != received) {
+        std::swap(d.buffer, datagrams[i].buffer);
+      }
+      d.to = address_;
+      d.length = headers[i].msg_len;
+      received++;
+    }
+    if (received > 0) {
+      return received;
+    }
+  }
+}
+
+Delivery UnixSocket::SendLocal(const Address& to, const char* buffer,
+                               const size_t length) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, UnixPath(to).c_str(),
+               sizeof(address.sun_path) - 1);
+  // Never wait on a peer's full queue, which would hold up every other peer
+  if (sendto(local_socket_, buffer, length, MSG_DONTWAIT,
+             (struct sockaddr*)&address, sizeof(struct sockaddr_un)) >= 0) {
+    return Delivery::kSent;
+  }
+  if (errno == EAGAIN || errno == EWOULDBLOCK) {
+    return Delivery::kBusy;
+  }
+  Error() << "Failed to send Unix datagram to " << to << ": "
+          << std::strerror(errno) << std::endl;
+  // Peer may have gone, or been replaced, so look again on next contact
+  std::scoped_lock lock(peers_mutex_);
+  peers_.erase(to);
+  return Delivery::kUnreachable;
+}
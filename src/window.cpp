@@ -0,0 +1,49 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/sequence.h>
+#include <Wink/window.h>
+
+bool ReceiveWindow::Receive(const uint64_t seq_num) {
+  if (!started_) {
+    started_ = true;
+    if (seq_num >= kWindowSize) {
+      cumulative_ = seq_num;
+      return true;
+    }
+    // Peer has only just started, so expect everything from zero
+    cumulative_ = -1;
+  }
+  if (!SequenceBefore(cumulative_, seq_num)) {
+    return false;
+  }
+  uint64_t offset = seq_num - cumulative_ - 1;
+  if (offset >= kWindowSize) {
+    // Slide the window forward, giving up on anything that falls behind it
+    const auto shift = offset - kWindowSize + 1;
+    cumulative_ += shift;
+    selective_ = shift < kWindowSize ? selective_ >> shift : 0;
+    offset = kWindowSize - 1;
+  }
+  const uint64_t bit = uint64_t(1) << offset;
+  if (selective_ & bit) {
+    return false;
+  }
+  selective_ |= bit;
+  while (selective_ & 1) {
+    cumulative_++;
+    selective_ >>= 1;
+  }
+  return true;
+}
+
+void ReceiveWindow::Skip(const uint64_t seq_num) {
+  if (!started_ || !SequenceBefore(cumulative_, seq_num - 1)) {
+    return;
+  }
+  const uint64_t shift = seq_num - 1 - cumulative_;
+  cumulative_ += shift;
+  selective_ = shift < kWindowSize ? selective_ >> shift : 0;
+  while (selective_ & 1) {
+    cumulative_++;
+    selective_ >>= 1;
+  }
+}
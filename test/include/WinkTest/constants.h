@@ -8,7 +8,7 @@
 
 // Constants for Testing
 
-constexpr size_t kMaxTestPayload(20);
+constexpr size_t kMaxTestPayload(256);
 constexpr uint16_t kTestPort(42424);
 constexpr pid_t kTestPID(2424);
 
@@ -17,11 +17,12 @@ constexpr std::string kTestMulticastIP("232.34.56.78");
 constexpr std::string kTestBinary("wink.bin");
 constexpr std::string kTestMessage("test 1234");
 
-constexpr char kTestPacket[] = {'\0', '\0', '\0', '\0', '\0', '\0',
-                                '\0', '\0', 't',  'e',  's',  't',
-                                ' ',  '1',  '2',  '3',  '4'};
-constexpr char kTestAck[] = {'\0', '\0', '\0', '\0', '\0', '\0',
-                             '\0', '\0', 'a',  'c',  'k'};
+// Version 1 data message with sequence number 0, followed by kTestMessage
+constexpr char kTestPacket[] = {1,   0,   0,   0,   0,   9,   0,   0,   0,
+                                0,   0,   0,   0,   0,   0,   0,   't', 'e',
+                                's', 't', ' ', '1', '2', '3', '4'};
+// Version 1 acknowledgement of sequence number 0
+constexpr char kTestAck[] = {1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 constexpr size_t kTestPacketLength(sizeof(kTestPacket) /
                                    sizeof(kTestPacket[0]));
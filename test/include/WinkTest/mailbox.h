@@ -25,6 +25,7 @@ struct SendArgs {
   std::string toIP;
   uint16_t toPort;
   std::string message;
+  Priority priority;
 };
 
 typedef bool SendResult;
@@ -35,8 +36,11 @@ class MockMailbox : public Mailbox {
   MockMailbox(const MockMailbox& s) = delete;
   MockMailbox(MockMailbox&& s) = delete;
   ~MockMailbox() {}
+  using Mailbox::Receive;
+  using Mailbox::Send;
   bool Receive(Address& from, Address& to, std::string& message) override;
-  void Send(const Address& to, const std::string& message) override;
+  void Send(const Address& to, const std::string& message,
+            const Priority priority) override;
   bool Flushed() override { return flushed_; }
 
   std::vector<ReceiveArgs> receiveArgs_;
@@ -2,10 +2,53 @@
 #ifndef TEST_INCLUDE_WINKTEST_UTILS_H_
 #define TEST_INCLUDE_WINKTEST_UTILS_H_
 
+#include <Wink/header.h>
+#include <WinkTest/constants.h>
+#include <endian.h>
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <string>
+
 #define ASSERT_ARRAY_EQ(length, expected, actual) \
   for (size_t i = 0; i < length; i++)             \
     ASSERT_EQ(expected[i], actual[i]) << "Index: " << i;
 
+/**
+ * Returns a datagram holding the message with the given sequence number in
+ * the given lane.
+ */
+inline std::string TestPacket(const uint64_t seq_num,
+                              const std::string& message = kTestMessage,
+                              const uint8_t lane = 0) {
+  Header header;
+  header.lane = lane;
+  header.length = message.length();
+  header.seq_num = seq_num;
+  std::string packet(kHeaderLength, '\0');
+  header.WriteTo(packet.data());
+  return packet + message;
+}
+
+/**
+ * Returns a datagram acknowledging the given lane's messages up to cumulative,
+ * and those selected by the bitmap beyond it.
+ */
+inline std::string TestAck(const uint64_t cumulative,
+                           const uint64_t selective = 0,
+                           const uint8_t lane = 0) {
+  Header header;
+  header.type = MessageType::kAck;
+  header.lane = lane;
+  header.seq_num = cumulative;
+  std::string ack(kHeaderLength, '\0');
+  if (selective != 0) {
+    const uint64_t s = htobe64(selective);
+    header.length = sizeof(uint64_t);
+    ack.append(reinterpret_cast<const char*>(&s), sizeof(uint64_t));
+  }
+  header.WriteTo(ack.data());
+  return ack;
+}
+
 #endif  // TEST_INCLUDE_WINKTEST_UTILS_H_
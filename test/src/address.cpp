@@ -3,6 +3,11 @@
 #include <WinkTest/constants.h>
 #include <gtest/gtest.h>
 
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
 TEST(AddressTest, ReadFrom) {
   struct sockaddr_in a;
   a.sin_family = AF_INET;
@@ -32,6 +37,40 @@ TEST(AddressTest, WriteTo_ResolveHostname) {
   ASSERT_EQ(htons(kTestPort), a.sin_port);
 }
 
+TEST(AddressTest, ResolveHostname) {
+  Address address("localhost", kTestPort);
+  ASSERT_EQ(kLocalhost, address.ip());
+  ASSERT_EQ(Address(kLocalhost, kTestPort), address);
+}
+
+TEST(AddressTest, ResolveHostname_Unresolvable) {
+  ASSERT_THROW(Address("wink.invalid", kTestPort), std::invalid_argument);
+  ASSERT_THROW(Address("999.0.0.1", kTestPort), std::invalid_argument);
+}
+
+TEST(AddressTest, Equality) {
+  const Address address(kTestUnicastIP, kTestPort);
+  ASSERT_EQ(Address(kTestUnicastIP, kTestPort), address);
+  // Same port, different IP
+  ASSERT_NE(Address(kLocalhost, kTestPort), address);
+  // Same IP, different port
+  ASSERT_NE(Address(kTestUnicastIP, kTestPort + 1), address);
+  ASSERT_LT(Address(kTestUnicastIP, kTestPort), Address(kTestUnicastIP, 65535));
+}
+
+TEST(AddressTest, Hash) {
+  std::unordered_set<Address> addresses;
+  addresses.emplace(kLocalhost, kTestPort);
+  addresses.emplace(kTestUnicastIP, kTestPort);
+  addresses.emplace(kTestUnicastIP, kTestPort + 1);
+  addresses.emplace("localhost", kTestPort);
+  ASSERT_EQ(3, addresses.size());
+  ASSERT_TRUE(addresses.contains(Address(kTestUnicastIP, kTestPort)));
+  ASSERT_FALSE(addresses.contains(Address(kTestMulticastIP, kTestPort)));
+  ASSERT_EQ(std::hash<Address>()(Address(kLocalhost, kTestPort)),
+            std::hash<Address>()(Address("localhost", kTestPort)));
+}
+
 TEST(AddressTest, IsMulticast) {
   {
     Address address("localhost", kTestPort);
@@ -1,12 +1,22 @@
 // Copyright 2022-2025 Stuart Scott
 #include <Wink/constants.h>
+#include <Wink/header.h>
 #include <Wink/mailbox.h>
 #include <WinkTest/constants.h>
 #include <WinkTest/socket.h>
 #include <WinkTest/utils.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 TEST(AsyncMailboxTest, Timeout) {
   Address address(kLocalhost, 0);
@@ -19,6 +29,22 @@ TEST(AsyncMailboxTest, Timeout) {
   ASSERT_FALSE(mailbox.Receive(from, to, message));
 }
 
+TEST(AsyncMailboxTest, Timeout_Deadline) {
+  Address address(kLocalhost, 0);
+  UDPSocket socket(address);
+  AsyncMailbox mailbox(socket);
+
+  Address from;
+  Address to;
+  std::string message;
+  const auto start = std::chrono::system_clock::now();
+  const auto deadline = start + std::chrono::milliseconds(100);
+  ASSERT_FALSE(mailbox.Receive(from, to, message, deadline));
+  const auto end = std::chrono::system_clock::now();
+  ASSERT_GE(end, deadline);
+  ASSERT_LT(end - start, kReceiveTimeout);
+}
+
 TEST(AsyncMailboxTest, UnicastDelivery_Thread) {
   Address receiver_address(kLocalhost, 0);
   UDPSocket receiver_socket(receiver_address);
@@ -79,6 +105,96 @@ TEST(AsyncMailboxTest, UnicastDelivery_Process) {
   }
 }
 
+TEST(AsyncMailboxTest, UnicastDelivery_Sharded) {
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address, 4);
+  AsyncMailbox receiver_mailbox(receiver_socket, true);
+
+  // Sockets refer to their addresses, which mustn't move
+  std::deque<Address> sender_addresses;
+  std::vector<std::unique_ptr<UDPSocket>> sender_sockets;
+  std::vector<std::unique_ptr<AsyncMailbox>> sender_mailboxes;
+  for (size_t i = 0; i < 4; i++) {
+    auto& sender_address = sender_addresses.emplace_back(kLocalhost, 0);
+    sender_sockets.push_back(std::make_unique<UDPSocket>(sender_address));
+    sender_mailboxes.push_back(
+        std::make_unique<AsyncMailbox>(*sender_sockets.back()));
+  }
+  for (size_t j = 0; j < 10; j++) {
+    for (auto& sender_mailbox : sender_mailboxes) {
+      sender_mailbox->Send(receiver_address, std::to_string(j));
+    }
+  }
+
+  // Every shard feeds the same queue, in order for each sender
+  std::map<Address, size_t> next;
+  for (size_t i = 0; i < sender_addresses.size() * 10; i++) {
+    Address from;
+    Address to;
+    std::string message;
+    bool success = false;
+    for (uint8_t r = 0; r < kMaxRetries && !success; r++) {
+      success = receiver_mailbox.Receive(from, to, message);
+    }
+    ASSERT_TRUE(success);
+    ASSERT_EQ(receiver_address, to);
+    ASSERT_EQ(std::to_string(next[from]++), message);
+  }
+  for (const auto& sender_address : sender_addresses) {
+    ASSERT_EQ(10, next[sender_address]);
+  }
+}
+
+TEST(AsyncMailboxTest, SelfDelivery) {
+  Address address(kLocalhost, 0);
+  UDPSocket socket(address);
+  AsyncMailbox mailbox(socket);
+  ASSERT_TRUE(socket.Self(address));
+  ASSERT_FALSE(socket.Self(Address(kTestUnicastIP, address.port())));
+
+  for (size_t i = 0; i < 10; i++) {
+    mailbox.Send(address, std::to_string(i));
+  }
+  ASSERT_TRUE(mailbox.TrySend(address, "10", std::chrono::system_clock::now()));
+  // Nothing was sent, so nothing awaits acknowledgement
+  ASSERT_TRUE(mailbox.Flushed());
+  ASSERT_TRUE(mailbox.RoundTrips().empty());
+
+  for (size_t i = 0; i <= 10; i++) {
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_TRUE(mailbox.Receive(from, to, message));
+    ASSERT_EQ(address, from);
+    ASSERT_EQ(address, to);
+    ASSERT_EQ(std::to_string(i), message);
+  }
+}
+
+TEST(AsyncMailboxTest, RoundTrips) {
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address);
+  AsyncMailbox receiver_mailbox(receiver_socket);
+
+  Address sender_address(kLocalhost, 0);
+  UDPSocket sender_socket(sender_address);
+  AsyncMailbox sender_mailbox(sender_socket);
+  ASSERT_TRUE(sender_mailbox.RoundTrips().empty());
+
+  sender_mailbox.Send(receiver_address, kTestMessage);
+  while (!sender_mailbox.Flushed()) {
+  }
+
+  const auto round_trips = sender_mailbox.RoundTrips();
+  ASSERT_EQ(1, round_trips.size());
+  const auto& [peer, rt] = *round_trips.begin();
+  ASSERT_EQ(receiver_address, peer);
+  ASSERT_EQ(1, rt.samples());
+  // Loopback is much faster than the initial estimate
+  ASSERT_LT(rt.smoothed(), kInitialRetransmitTimeout);
+  ASSERT_LT(rt.Timeout(), kInitialRetransmitTimeout);
+}
+
 TEST(AsyncMailboxTest, UnicastAcknowledgement) {
   MockSocket sender_socket;
   AsyncMailbox sender_mailbox(sender_socket);
@@ -304,6 +420,593 @@ TEST(AsyncMailboxTest, UnicastRetry_DroppedAck) {
   }
 }
 
+TEST(AsyncMailboxTest, CoalescedAcknowledgement) {
+  MockSocket receiver_socket;
+  AsyncMailbox receiver_mailbox(receiver_socket);
+  Address receiver_address(kLocalhost, 0);
+  Address sender_address(kLocalhost, 0);
+
+  // Message 1 is lost
+  for (const auto seq_num : {0, 2, 3}) {
+    const auto p = TestPacket(seq_num);
+    receiver_socket.Push(sender_address, receiver_address, p.data(),
+                         p.length());
+  }
+  for (size_t i = 0; i < 3; i++) {
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+    ASSERT_EQ(kTestMessage, message);
+  }
+
+  // Single acknowledgement covers all received messages
+  {
+    Address to;
+    char buffer[kMaxTestPayload];
+    size_t length;
+    receiver_socket.Await(to, buffer, length);
+    const auto expected = TestAck(0, 0b110);
+    ASSERT_EQ(expected.length(), length);
+    ASSERT_ARRAY_EQ(length, expected, buffer);
+    ASSERT_FALSE(receiver_socket.Pop(to, buffer, length));
+  }
+
+  // Retransmission of message 1 fills the gap
+  {
+    const auto p = TestPacket(1);
+    receiver_socket.Push(sender_address, receiver_address, p.data(),
+                         p.length());
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+    ASSERT_EQ(kTestMessage, message);
+  }
+  {
+    Address to;
+    char buffer[kMaxTestPayload];
+    size_t length;
+    receiver_socket.Await(to, buffer, length);
+    const auto expected = TestAck(3);
+    ASSERT_EQ(expected.length(), length);
+    ASSERT_ARRAY_EQ(length, expected, buffer);
+  }
+}
+
+TEST(AsyncMailboxTest, Backpressure) {
+  MockSocket socket;
+  AsyncMailbox mailbox(socket, false, 2, 3);
+  Address sender_address(kLocalhost, 0);
+  Address a(kLocalhost, kTestPort);
+  Address b(kLocalhost, kTestPort + 1);
+
+  mailbox.Send(a, kTestMessage);
+  mailbox.Send(a, kTestMessage);
+
+  // Peer limit reached
+  const auto start = std::chrono::system_clock::now();
+  ASSERT_FALSE(mailbox.TrySend(a, kTestMessage, start));
+  ASSERT_FALSE(mailbox.TrySend(a, kTestMessage,
+                               start + std::chrono::milliseconds(50)));
+  ASSERT_GE(std::chrono::system_clock::now() - start,
+            std::chrono::milliseconds(50));
+
+  // Other peers have room, until the total limit is reached
+  ASSERT_TRUE(
+      mailbox.TrySend(b, kTestMessage, std::chrono::system_clock::now()));
+  ASSERT_FALSE(
+      mailbox.TrySend(b, kTestMessage, std::chrono::system_clock::now()));
+
+  // Acknowledgement makes room for a waiting sender
+  std::thread acknowledger{[&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const auto a0 = TestAck(0);
+    socket.Push(a, sender_address, a0.data(), a0.length());
+  }};
+  ASSERT_TRUE(mailbox.TrySend(
+      a, kTestMessage, std::chrono::system_clock::now() + kSendTimeout));
+  acknowledger.join();
+
+  for (const auto& [peer, cumulative] :
+       std::vector<std::pair<Address, uint64_t>>{{a, 2}, {b, 0}}) {
+    const auto p = TestAck(cumulative);
+    socket.Push(peer, sender_address, p.data(), p.length());
+  }
+  ASSERT_TRUE(mailbox.Flushed());
+}
+
+TEST(AsyncMailboxTest, PriorityLanes_Outgoing) {
+  MockSocket socket;
+  AsyncMailbox mailbox(socket);
+  Address sender_address(kLocalhost, 0);
+  Address receiver_address(kLocalhost, 0);
+  const std::string control("control");
+  mailbox.SetPacking(receiver_address, false);
+
+  // Fill the normal lane's window, so the last is held back
+  for (uint64_t i = 0; i <= kWindowSize; i++) {
+    mailbox.Send(receiver_address, kTestMessage);
+  }
+  mailbox.Send(receiver_address, control, Priority::kHigh);
+
+  // High lane has its own sequence numbers and window
+  for (uint64_t i = 0; i <= kWindowSize; i++) {
+    Address to;
+    char buffer[kMaxTestPayload];
+    size_t length;
+    socket.Await(to, buffer, length);
+    Header header;
+    ASSERT_TRUE(header.ReadFrom(buffer, length));
+    if (header.lane == static_cast<uint8_t>(Priority::kHigh)) {
+      const auto expected = TestPacket(0, control, header.lane);
+      ASSERT_EQ(expected.length(), length);
+      ASSERT_ARRAY_EQ(length, expected, buffer);
+      break;
+    }
+    ASSERT_LT(i, kWindowSize);
+  }
+
+  // Acknowledgements are per lane
+  auto ack = TestAck(0, 0, static_cast<uint8_t>(Priority::kHigh));
+  socket.Push(receiver_address, sender_address, ack.data(), ack.length());
+  ASSERT_FALSE(mailbox.Flushed());
+
+  ack = TestAck(kWindowSize);
+  socket.Push(receiver_address, sender_address, ack.data(), ack.length());
+  ASSERT_TRUE(mailbox.Flushed());
+}
+
+TEST(AsyncMailboxTest, PriorityLanes_Incoming) {
+  MockSocket socket;
+  AsyncMailbox mailbox(socket);
+  Address sender_address(kLocalhost, 0);
+  Address receiver_address(kLocalhost, 0);
+  const std::string control("control");
+
+  socket.Push(sender_address, receiver_address, &kTestPacket[0],
+              kTestPacketLength);
+  const auto packet =
+      TestPacket(0, control, static_cast<uint8_t>(Priority::kHigh));
+  socket.Push(sender_address, receiver_address, packet.data(),
+              packet.length());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // High lane is delivered first, and both are acknowledged
+  for (const auto& expected : {control, std::string(kTestMessage)}) {
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_TRUE(mailbox.Receive(from, to, message));
+    ASSERT_EQ(expected, message);
+  }
+  for (size_t i = 0; i < 2; i++) {
+    Address to;
+    char buffer[kMaxTestPayload];
+    size_t length;
+    socket.Await(to, buffer, length);
+    ASSERT_EQ(kTestAckLength, length);
+  }
+}
+
+TEST(AsyncMailboxTest, ReceiveBatch) {
+  MockSocket socket;
+  AsyncMailbox mailbox(socket);
+  Address sender_address(kLocalhost, 0);
+  Address receiver_address(kLocalhost, 0);
+  const std::string control("control");
+
+  const auto packed = TestPacket(0) + TestPacket(1) +
+                      TestPacket(0, control,
+                                 static_cast<uint8_t>(Priority::kHigh));
+  socket.Push(sender_address, receiver_address, packed.data(),
+              packed.length());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Batch is limited to max, and drains the high lane first
+  std::vector<ReceivedMessage> messages;
+  ASSERT_EQ(2, mailbox.ReceiveBatch(messages, 2));
+  ASSERT_EQ(2, messages.size());
+  ASSERT_EQ(control, messages.at(0).message);
+  ASSERT_EQ(sender_address, messages.at(0).from);
+  ASSERT_EQ(receiver_address, messages.at(0).to);
+  ASSERT_EQ(kTestMessage, messages.at(1).message);
+
+  // Remainder is received by the next batch
+  ASSERT_EQ(1, mailbox.ReceiveBatch(messages, 2));
+  ASSERT_EQ(1, messages.size());
+  ASSERT_EQ(kTestMessage, messages.at(0).message);
+}
+
+TEST(AsyncMailboxTest, IncomingFull) {
+  MockSocket socket;
+  Address sender_address(kLocalhost, 0);
+  Address receiver_address(kLocalhost, 0);
+  const size_t count = kQueueCapacity + 100;
+  std::vector<std::string> packets;
+  for (size_t i = 0; i < count; i++) {
+    packets.push_back(TestPacket(i, std::to_string(i)));
+  }
+  {
+    AsyncMailbox mailbox(socket);
+    for (const auto& p : packets) {
+      socket.Push(sender_address, receiver_address, p.data(), p.length());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Messages that didn't fit are delivered as Receive makes room
+    std::vector<ReceivedMessage> messages;
+    for (size_t i = 0; i < count;) {
+      ASSERT_GT(mailbox.ReceiveBatch(messages, kReceiveBatch), 0);
+      for (const auto& m : messages) {
+        ASSERT_EQ(std::to_string(i++), m.message);
+      }
+    }
+
+    // Shutting down doesn't wait for room
+    Address other_address(kLocalhost, kTestPort);
+    for (const auto& p : packets) {
+      socket.Push(other_address, receiver_address, p.data(), p.length());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+TEST(AsyncMailboxTest, Packing_Outgoing) {
+  MockSocket socket;
+  AsyncMailbox mailbox(socket);
+  mailbox.SetPackBudget(kMaxPackedSize, std::chrono::milliseconds(100));
+  Address sender_address(kLocalhost, 0);
+  Address receiver_address(kLocalhost, 0);
+
+  for (size_t i = 0; i < 3; i++) {
+    mailbox.Send(receiver_address, kTestMessage);
+  }
+
+  // Messages share a datagram, each with its own sequence number
+  Address to;
+  char buffer[kMaxTestPayload];
+  size_t length;
+  socket.Await(to, buffer, length);
+  ASSERT_EQ(receiver_address, to);
+  const auto expected = TestPacket(0) + TestPacket(1) + TestPacket(2);
+  ASSERT_EQ(expected.length(), length);
+  ASSERT_ARRAY_EQ(length, expected, buffer);
+
+  const auto ack = TestAck(2);
+  socket.Push(receiver_address, sender_address, ack.data(), ack.length());
+  ASSERT_TRUE(mailbox.Flushed());
+}
+
+TEST(AsyncMailboxTest, Packing_Disabled) {
+  MockSocket socket;
+  AsyncMailbox mailbox(socket);
+  mailbox.SetPackBudget(kMaxPackedSize, std::chrono::milliseconds(100));
+  Address sender_address(kLocalhost, 0);
+  Address receiver_address(kLocalhost, 0);
+  mailbox.SetPacking(receiver_address, false);
+
+  for (size_t i = 0; i < 3; i++) {
+    mailbox.Send(receiver_address, kTestMessage);
+  }
+
+  // Messages are sent one per datagram
+  for (uint64_t i = 0; i < 3; i++) {
+    Address to;
+    char buffer[kMaxTestPayload];
+    size_t length;
+    socket.Await(to, buffer, length);
+    const auto expected = TestPacket(i);
+    ASSERT_EQ(expected.length(), length);
+    ASSERT_ARRAY_EQ(length, expected, buffer);
+  }
+
+  const auto ack = TestAck(2);
+  socket.Push(receiver_address, sender_address, ack.data(), ack.length());
+  ASSERT_TRUE(mailbox.Flushed());
+}
+
+TEST(AsyncMailboxTest, Packing_Incoming) {
+  MockSocket socket;
+  AsyncMailbox mailbox(socket);
+  Address sender_address(kLocalhost, 0);
+  Address receiver_address(kLocalhost, 0);
+
+  const auto packed = TestPacket(0) + TestPacket(1);
+  socket.Push(sender_address, receiver_address, packed.data(),
+              packed.length());
+
+  for (size_t i = 0; i < 2; i++) {
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_TRUE(mailbox.Receive(from, to, message));
+    ASSERT_EQ(kTestMessage, message);
+  }
+
+  // Both are acknowledged at once
+  Address to;
+  char buffer[kMaxTestPayload];
+  size_t length;
+  socket.Await(to, buffer, length);
+  const auto expected = TestAck(1);
+  ASSERT_EQ(expected.length(), length);
+  ASSERT_ARRAY_EQ(length, expected, buffer);
+}
+
+TEST(AsyncMailboxTest, LateDelivery) {
+  MockSocket receiver_socket;
+  AsyncMailbox receiver_mailbox(receiver_socket);
+  Address receiver_address(kLocalhost, 0);
+  Address sender_address(kLocalhost, 0);
+
+  // Message 1 overtakes message 0, and 0 is still delivered
+  for (const uint64_t seq_num : {1, 0, 1}) {
+    auto packet = TestPacket(seq_num);
+    packet.back() = '0' + seq_num;
+    receiver_socket.Push(sender_address, receiver_address, packet.data(),
+                         packet.length());
+  }
+  for (const auto expected : {"test 1231", "test 1230"}) {
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+    ASSERT_EQ(expected, message);
+  }
+  // Duplicate is dropped
+  {
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_FALSE(receiver_mailbox.Receive(from, to, message));
+  }
+}
+
+TEST(AsyncMailboxTest, OrderedDelivery) {
+  MockSocket receiver_socket;
+  AsyncMailbox receiver_mailbox(receiver_socket, true);
+  Address receiver_address(kLocalhost, 0);
+  Address sender_address(kLocalhost, 0);
+
+  for (const uint64_t seq_num : {2, 1, 0, 3}) {
+    auto packet = TestPacket(seq_num);
+    packet.back() = '0' + seq_num;
+    receiver_socket.Push(sender_address, receiver_address, packet.data(),
+                         packet.length());
+  }
+  for (const auto expected :
+       {"test 1230", "test 1231", "test 1232", "test 1233"}) {
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+    ASSERT_EQ(expected, message);
+  }
+}
+
+TEST(AsyncMailboxTest, OrderedDelivery_Abandoned) {
+  MockSocket receiver_socket;
+  AsyncMailbox receiver_mailbox(receiver_socket, true);
+  Address receiver_address(kLocalhost, 0);
+  Address sender_address(kLocalhost, 0);
+
+  // Message 1 never arrives
+  for (const uint64_t seq_num : {0, 2}) {
+    auto packet = TestPacket(seq_num);
+    packet.back() = '0' + seq_num;
+    receiver_socket.Push(sender_address, receiver_address, packet.data(),
+                         packet.length());
+  }
+  Address from;
+  Address to;
+  std::string message;
+  ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+  ASSERT_EQ("test 1230", message);
+
+  // Message 2 is held until the receiver gives up on message 1
+  const auto start = std::chrono::system_clock::now();
+  ASSERT_TRUE(receiver_mailbox.Receive(from, to, message,
+                                       start + 2 * kReorderTimeout));
+  ASSERT_GE(std::chrono::system_clock::now() - start,
+            kReorderTimeout - std::chrono::milliseconds(100));
+  ASSERT_EQ("test 1232", message);
+
+  // Message 1 arriving late would break the order, so it is dropped
+  auto packet = TestPacket(1);
+  receiver_socket.Push(sender_address, receiver_address, packet.data(),
+                       packet.length());
+  ASSERT_FALSE(receiver_mailbox.Receive(from, to, message));
+}
+
+TEST(AsyncMailboxTest, OrderedDelivery_LastRetry) {
+  MockSocket sender_socket;
+  AsyncMailbox sender_mailbox(sender_socket);
+  Address sender_address(kLocalhost, 0);
+
+  MockSocket receiver_socket;
+  AsyncMailbox receiver_mailbox(receiver_socket, true);
+  Address receiver_address(kLocalhost, 0);
+  sender_mailbox.SetPacking(receiver_address, false);
+
+  // Message 0 is lost until the sender's last attempt, and message 1's first
+  // attempt is lost too, so no round trip is measured and the sender's
+  // retransmission timeout stays at its initial value
+  std::atomic_bool running = true;
+  std::thread relay{[&] {
+    std::map<uint64_t, size_t> attempts;
+    Address to;
+    char buffer[kMaxTestPayload];
+    size_t length;
+    while (running) {
+      while (sender_socket.Pop(to, buffer, length)) {
+        Header header;
+        ASSERT_TRUE(header.ReadFrom(buffer, length));
+        if (header.type == MessageType::kData) {
+          const auto a = ++attempts[header.seq_num];
+          if ((header.seq_num == 0 && a < kMaxRetries) ||
+              (header.seq_num == 1 && a == 1)) {
+            continue;
+          }
+        }
+        receiver_socket.Push(sender_address, receiver_address, buffer,
+                             length);
+      }
+      while (receiver_socket.Pop(to, buffer, length)) {
+        sender_socket.Push(receiver_address, sender_address, buffer, length);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }};
+
+  sender_mailbox.Send(receiver_address, "test 0");
+  sender_mailbox.Send(receiver_address, "test 1");
+
+  // Message 1 is held until message 0 arrives, rather than given up on
+  const auto deadline = std::chrono::system_clock::now() + 2 * kReorderTimeout;
+  for (const auto expected : {"test 0", "test 1"}) {
+    Address from;
+    Address to;
+    std::string message;
+    ASSERT_TRUE(receiver_mailbox.Receive(from, to, message, deadline));
+    ASSERT_EQ(expected, message);
+  }
+  ASSERT_TRUE(sender_mailbox.Flushed());
+
+  running = false;
+  relay.join();
+}
+
+TEST(AsyncMailboxTest, SelectiveAcknowledgement) {
+  MockSocket sender_socket;
+  AsyncMailbox sender_mailbox(sender_socket);
+  Address sender_address(kLocalhost, 0);
+  Address receiver_address(kLocalhost, 0);
+  sender_mailbox.SetPacking(receiver_address, false);
+
+  for (size_t i = 0; i < 4; i++) {
+    sender_mailbox.Send(receiver_address, kTestMessage);
+  }
+  for (size_t i = 0; i < 4; i++) {
+    Address to;
+    char buffer[kMaxTestPayload];
+    size_t length;
+    sender_socket.Await(to, buffer, length);
+  }
+
+  // Acknowledge 0, 2, and 3
+  {
+    const auto ack = TestAck(0, 0b110);
+    sender_socket.Push(receiver_address, sender_address, ack.data(),
+                       ack.length());
+  }
+  ASSERT_FALSE(sender_mailbox.Flushed());
+
+  // Acknowledging 1 completes the set
+  {
+    const auto ack = TestAck(1);
+    sender_socket.Push(receiver_address, sender_address, ack.data(),
+                       ack.length());
+  }
+  ASSERT_TRUE(sender_mailbox.Flushed());
+}
+
+// Reaches every peer reliably, while they're reachable
+class ReliableSocket : public MockSocket {
+ public:
+  bool Reliable(const Address&) override { return true; }
+  Delivery SendReliable(const Address& to, const char* buffer,
+                        const size_t length) override {
+    if (!reachable) {
+      return Delivery::kUnreachable;
+    }
+    return Send(to, buffer, length) ? Delivery::kSent : Delivery::kUnreachable;
+  }
+  std::atomic_bool reachable = false;
+};
+
+TEST(AsyncMailboxTest, Reliable_Rerouted) {
+  ReliableSocket socket;
+  AsyncMailbox mailbox(socket);
+  Address sender_address(kLocalhost, 0);
+  Address peer(kLocalhost, kTestPort);
+
+  // Returns the type and sequence number of the next datagram holding message
+  const auto await = [&](const std::string& message) {
+    while (true) {
+      Address to;
+      char buffer[kMaxTestPayload];
+      size_t length;
+      socket.Await(to, buffer, length);
+      Header header;
+      EXPECT_TRUE(header.ReadFrom(buffer, length));
+      if (std::string(buffer + kHeaderLength, header.length) == message) {
+        return std::make_pair(header.type, header.seq_num);
+      }
+    }
+  };
+
+  // Peer can't be reached reliably, so the message falls back to the network
+  mailbox.Send(peer, "first");
+  ASSERT_EQ(std::make_pair(MessageType::kData, uint64_t(0)), await("first"));
+
+  // Peer is reachable again, but stays on the network until the first message
+  // is acknowledged, so the second can't overtake it
+  socket.reachable = true;
+  mailbox.Send(peer, "second");
+  ASSERT_EQ(std::make_pair(MessageType::kData, uint64_t(1)), await("second"));
+
+  const auto ack = TestAck(1);
+  socket.Push(peer, sender_address, ack.data(), ack.length());
+  ASSERT_TRUE(mailbox.Flushed());
+  mailbox.Send(peer, "third");
+  ASSERT_EQ(std::make_pair(MessageType::kUnsequenced, uint64_t(0)),
+            await("third"));
+}
+
+class CountingSocket : public UDPSocket {
+ public:
+  explicit CountingSocket(Address& address) : UDPSocket(address) {}
+  size_t ReceiveShard(std::vector<Datagram>& datagrams,
+                      const size_t shard) override {
+    calls++;
+    return UDPSocket::ReceiveShard(datagrams, shard);
+  }
+  size_t SendBatch(const std::vector<Datagram>& datagrams,
+                   const size_t count) override {
+    calls++;
+    return UDPSocket::SendBatch(datagrams, count);
+  }
+  std::atomic_size_t calls = 0;
+};
+
+TEST(AsyncMailboxTest, Idle) {
+  // Peer receives but does not acknowledge
+  Address peer_address(kLocalhost, 0);
+  UDPSocket peer_socket(peer_address);
+
+  Address address(kLocalhost, 0);
+  CountingSocket socket(address);
+  AsyncMailbox mailbox(socket);
+  mailbox.Send(peer_address, kTestMessage);
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(peer_socket.Receive(from, to, buffer, length));
+
+  // Mailbox should sleep while awaiting acknowledgement, waking only to
+  // retransmit, or when receiving times out
+  const auto before = socket.calls.load();
+  sleep(1);
+  const auto calls = socket.calls - before;
+  ASSERT_LT(calls, 10) << "Made " << calls << " socket calls";
+
+  ASSERT_TRUE(peer_socket.Send(from, kTestAck, kTestAckLength));
+  ASSERT_TRUE(mailbox.Flushed());
+}
+
 TEST(AsyncMailboxTest, MulticastDelivery_Thread) {
   Address receiver_address(kLocalhost, 0);
   UDPSocket receiver_socket(receiver_address);
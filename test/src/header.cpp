@@ -0,0 +1,62 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/header.h>
+#include <WinkTest/utils.h>
+#include <gtest/gtest.h>
+
+TEST(HeaderTest, WriteTo) {
+  Header header;
+  header.type = MessageType::kAck;
+  header.flags = 0x5a;
+  header.lane = 1;
+  header.length = 0x0a0b;
+  header.seq_num = 0x0102030405060708;
+  char buffer[kHeaderLength];
+  header.WriteTo(buffer);
+
+  // Network byte order at fixed offsets
+  const char expected[kHeaderLength] = {1, 1, 0x5a, 1, 0x0a, 0x0b, 0, 0,
+                                        1, 2, 3,    4, 5,    6,    7, 8};
+  ASSERT_ARRAY_EQ(kHeaderLength, expected, buffer);
+}
+
+TEST(HeaderTest, ReadFrom) {
+  Header header;
+  header.type = MessageType::kUnsequenced;
+  header.lane = 1;
+  header.length = 2;
+  header.seq_num = 0xfffffffffffffffe;
+  char buffer[kHeaderLength + 2];
+  header.WriteTo(buffer);
+
+  Header decoded;
+  ASSERT_TRUE(decoded.ReadFrom(buffer, sizeof(buffer)));
+  ASSERT_EQ(kWireVersion, decoded.version);
+  ASSERT_EQ(MessageType::kUnsequenced, decoded.type);
+  ASSERT_EQ(0, decoded.flags);
+  ASSERT_EQ(1, decoded.lane);
+  ASSERT_EQ(2, decoded.length);
+  ASSERT_EQ(0xfffffffffffffffe, decoded.seq_num);
+}
+
+TEST(HeaderTest, ReadFrom_Truncated) {
+  Header header;
+  header.length = 2;
+  char buffer[kHeaderLength + 2];
+  header.WriteTo(buffer);
+
+  Header decoded;
+  // Header is incomplete
+  ASSERT_FALSE(decoded.ReadFrom(buffer, kHeaderLength - 1));
+  // Payload is incomplete
+  ASSERT_FALSE(decoded.ReadFrom(buffer, kHeaderLength + 1));
+}
+
+TEST(HeaderTest, ReadFrom_Version) {
+  Header header;
+  header.version = kWireVersion + 1;
+  char buffer[kHeaderLength];
+  header.WriteTo(buffer);
+
+  Header decoded;
+  ASSERT_FALSE(decoded.ReadFrom(buffer, sizeof(buffer)));
+}
@@ -0,0 +1,159 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/io_uring.h>
+#include <Wink/mailbox.h>
+#include <Wink/socket.h>
+#include <WinkTest/constants.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST(IOUringTest, SubmitComplete) {
+  std::unique_ptr<IOUring> ring;
+  try {
+    ring = std::make_unique<IOUring>(4);
+  } catch (const std::runtime_error& e) {
+    GTEST_SKIP() << e.what();
+  }
+  ASSERT_TRUE(ring->Supports(IORING_OP_NOP));
+
+  io_uring_cqe cqe;
+  ASSERT_FALSE(ring->Complete(cqe));
+  for (uint64_t i = 0; i < 2; i++) {
+    auto sqe = ring->Prepare();
+    ASSERT_NE(nullptr, sqe);
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = i;
+  }
+  ASSERT_TRUE(ring->Submit(2));
+  ASSERT_TRUE(ring->Complete(cqe));
+  ASSERT_EQ(0, cqe.user_data);
+  ASSERT_EQ(0, cqe.res);
+  ASSERT_TRUE(ring->Complete(cqe));
+  ASSERT_EQ(1, cqe.user_data);
+  ASSERT_FALSE(ring->Complete(cqe));
+}
+
+TEST(IOUringTest, Prepare_Full) {
+  std::unique_ptr<IOUring> ring;
+  try {
+    ring = std::make_unique<IOUring>(4);
+  } catch (const std::runtime_error& e) {
+    GTEST_SKIP() << e.what();
+  }
+  for (int i = 0; i < 4; i++) {
+    ASSERT_NE(nullptr, ring->Prepare());
+  }
+  ASSERT_EQ(nullptr, ring->Prepare());
+}
+
+TEST(IOUringSocketTest, SendReceive) {
+  Address sender_address(kLocalhost, 0);
+  IOUringSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  IOUringSocket receiver_socket(receiver_address);
+
+  ASSERT_TRUE(sender_socket.Send(receiver_address, kTestMessage.data(),
+                                 kTestMessage.length()));
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(receiver_address, to);
+  ASSERT_EQ(kTestMessage, std::string(buffer, length));
+}
+
+TEST(IOUringSocketTest, SendReceiveBatch) {
+  Address sender_address(kLocalhost, 0);
+  IOUringSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  IOUringSocket receiver_socket(receiver_address);
+
+  std::vector<std::string> messages(kMaxBatchSize);
+  std::vector<Datagram> outgoing(kMaxBatchSize);
+  for (size_t i = 0; i < kMaxBatchSize; i++) {
+    messages[i] = std::to_string(i);
+    outgoing[i].to = receiver_address;
+    outgoing[i].buffer = messages[i].data();
+    outgoing[i].length = messages[i].length();
+  }
+  ASSERT_EQ(kMaxBatchSize, sender_socket.SendBatch(outgoing, kMaxBatchSize));
+
+  // Received in the order they were sent
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> incoming(kMaxBatchSize);
+  std::vector<std::string> received;
+  while (received.size() < kMaxBatchSize) {
+    for (size_t i = 0; i < kMaxBatchSize; i++) {
+      incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+    }
+    const auto count = receiver_socket.ReceiveBatch(incoming);
+    ASSERT_GT(count, 0);
+    for (size_t i = 0; i < count; i++) {
+      ASSERT_EQ(sender_address, incoming[i].from);
+      ASSERT_EQ(receiver_address, incoming[i].to);
+      received.emplace_back(incoming[i].buffer, incoming[i].length);
+    }
+  }
+  ASSERT_EQ(messages, received);
+}
+
+TEST(IOUringSocketTest, ReceiveBatch_Coalesced) {
+  Address sender_address(kLocalhost, 0);
+  UDPSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  IOUringSocket receiver_socket(receiver_address);
+
+  // Datagrams coalesced by the sender arrive separately
+  std::vector<std::string> messages;
+  std::vector<Datagram> outgoing(kMaxBatchSize);
+  for (size_t i = 0; i < kMaxBatchSize; i++) {
+    messages.push_back(std::string(99, 'x') + std::to_string(i % 10));
+  }
+  for (size_t i = 0; i < kMaxBatchSize; i++) {
+    outgoing[i].to = receiver_address;
+    outgoing[i].buffer = messages[i].data();
+    outgoing[i].length = messages[i].length();
+  }
+  ASSERT_EQ(kMaxBatchSize, sender_socket.SendBatch(outgoing, kMaxBatchSize));
+
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> incoming(kMaxBatchSize);
+  std::vector<std::string> received;
+  while (received.size() < kMaxBatchSize) {
+    for (size_t i = 0; i < kMaxBatchSize; i++) {
+      incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+    }
+    const auto count = receiver_socket.ReceiveBatch(incoming);
+    ASSERT_GT(count, 0);
+    for (size_t i = 0; i < count; i++) {
+      received.emplace_back(incoming[i].buffer, incoming[i].length);
+    }
+  }
+  ASSERT_EQ(messages, received);
+}
+
+TEST(IOUringSocketTest, Mailbox) {
+  Address receiver_address(kLocalhost, 0);
+  IOUringSocket receiver_socket(receiver_address);
+  AsyncMailbox receiver_mailbox(receiver_socket);
+  Address sender_address(kLocalhost, 0);
+  IOUringSocket sender_socket(sender_address);
+  AsyncMailbox sender_mailbox(sender_socket);
+
+  sender_mailbox.Send(receiver_address, kTestMessage);
+
+  Address from;
+  Address to;
+  std::string message;
+  ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(receiver_address, to);
+  ASSERT_EQ(kTestMessage, message);
+  ASSERT_TRUE(sender_mailbox.Flushed());
+}
@@ -4,6 +4,7 @@
 #include <WinkTest/mailbox.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <string>
 #include <thread>
 #include <vector>
@@ -433,6 +434,94 @@ TEST(MachineTest, Transition_Hierarchy) {
   ASSERT_EQ(std::vector<int>{2}, exits);
 }
 
+TEST(MachineTest, Dispatch_Hierarchy) {
+  std::string name("test/Test");
+  MockMailbox mailbox;
+  Address address(":42002");
+  Address parent(":42001");
+
+  for (size_t i = 0; i < 4; i++) {
+    mailbox.sendResults_.push_back(true);
+  }
+  for (const auto& message :
+       {"a 1", "b 2", "c 3", "goto root", "a 4", "c 5", "exit"}) {
+    ReceiveResult result;
+    result.fromIP = kTestUnicastIP;
+    result.fromPort = kTestPort;
+    result.toIP = kTestUnicastIP;
+    result.toPort = kTestPort;
+    result.message = message;
+    result.result = true;
+    mailbox.receiveResults_.push_back(result);
+  }
+
+  std::vector<std::string> received;
+  const auto receiver = [&received](const std::string& r) {
+    return [&received, r](const Address& from, const Address& to,
+                          std::istream& args) {
+      std::string a;
+      std::getline(args, a);
+      received.push_back(r + ':' + a);
+    };
+  };
+
+  Machine m(name, mailbox, address, parent);
+  m.AddState(State(
+      // State Name
+      "leaf",
+      // Parent State
+      "middle",
+      // On Entry Action
+      []() {},
+      // On Exit Action
+      []() {},
+      // Receivers
+      {
+          {"a", receiver("leaf")},
+          {"goto",
+           [&m](const Address& from, const Address& to, std::istream& args) {
+             std::string s;
+             args >> s;
+             m.Transition(s);
+           }},
+      }));
+  m.AddState(State(
+      // State Name
+      "middle",
+      // Parent State
+      "root",
+      // On Entry Action
+      []() {},
+      // On Exit Action
+      []() {},
+      // Receivers
+      {
+          {"b", receiver("middle")},
+          {"", receiver("middle*")},
+      }));
+  m.AddState(State(
+      // State Name
+      "root",
+      // Parent State
+      "",
+      // On Entry Action
+      []() {},
+      // On Exit Action
+      []() {},
+      // Receivers
+      {
+          {"a", receiver("root")},
+          {"", receiver("root*")},
+      }));
+  m.Start();
+
+  // Nearest receiver wins, and a wildcard hides its ancestors' receivers,
+  // receiving the whole message
+  ASSERT_EQ((std::vector<std::string>{"leaf: 1", "middle: 2", "middle*:c 3",
+                                      "root: 4", "root*:c 5", "root*:exit"}),
+            received);
+}
+
 TEST(MachineTest, Send) {
   std::string name("test/Test");
   MockMailbox mailbox;
@@ -456,6 +545,30 @@ TEST(MachineTest, Send) {
   ASSERT_EQ(std::string(kTestMessage), arg.message);
 }
 
+TEST(MachineTest, TrySend) {
+  std::string name("test/Test");
+  MockMailbox mailbox;
+  Address address(":42002");
+  Address parent(":42001");
+
+  // Set mock send result
+  SendResult result = 0;
+  mailbox.sendResults_.push_back(result);
+
+  Machine m(name, mailbox, address, parent);
+
+  Address destination(":42003");
+  ASSERT_TRUE(
+      m.TrySend(destination, kTestMessage, std::chrono::system_clock::now()));
+
+  // Check mailbox send
+  ASSERT_EQ(1, mailbox.sendArgs_.size());
+  const auto arg = mailbox.sendArgs_.at(0);
+  ASSERT_EQ(destination.ip(), arg.toIP);
+  ASSERT_EQ(destination.port(), arg.toPort);
+  ASSERT_EQ(std::string(kTestMessage), arg.message);
+}
+
 TEST(MachineTest, SendAt) {
   std::string name("test/Test");
   Address address(":42002");
@@ -516,6 +629,96 @@ TEST(MachineTest, SendAfter) {
   worker.join();
 }
 
+TEST(MachineTest, SendAfter_Precise) {
+  std::string name("test/Test");
+  Address address(":42002");
+  Address parent(":42001");
+  const std::chrono::milliseconds delay(50);
+
+  UDPSocket socket(address);
+  AsyncMailbox mailbox(socket);
+  Machine m(name, mailbox, address, parent);
+  std::chrono::system_clock::time_point start;
+  std::chrono::system_clock::time_point end;
+  m.AddState(State(
+      // State Name
+      "main",
+      // Parent State
+      "",
+      // On Entry Action
+      [&]() {
+        start = std::chrono::system_clock::now();
+        m.SendAfter(address, "exit", delay);
+      },
+      // On Exit Action
+      []() {},
+      // Receivers
+      {
+          {"exit",
+           [&](const Address& from, const Address& to, std::istream& args) {
+             end = std::chrono::system_clock::now();
+             m.Exit();
+           }},
+      }));
+  m.Start();
+
+  // Received when due, not when the loop next times out
+  ASSERT_GE(end - start, delay);
+  ASSERT_LT(end - start, std::chrono::milliseconds(500));
+}
+
+TEST(MachineTest, SendEvery) {
+  std::string name("test/Test");
+  Address address(":42002");
+  Address parent(":42001");
+  const std::chrono::milliseconds period(20);
+
+  UDPSocket socket(address);
+  AsyncMailbox mailbox(socket);
+  Machine m(name, mailbox, address, parent);
+  std::chrono::system_clock::time_point start;
+  std::vector<std::chrono::system_clock::time_point> ticks;
+  uint64_t ticker;
+  m.AddState(State(
+      // State Name
+      "main",
+      // Parent State
+      "",
+      // On Entry Action
+      [&]() {
+        start = std::chrono::system_clock::now();
+        // Address is held by value, so may be a temporary
+        ticker = m.SendEvery(Address(":42002"), "tick", period);
+        const auto exit = m.SendAfter(address, "exit", period / 2);
+        ASSERT_TRUE(m.Cancel(exit));
+        ASSERT_FALSE(m.Cancel(exit));
+      },
+      // On Exit Action
+      []() {},
+      // Receivers
+      {
+          {"tick",
+           [&](const Address& from, const Address& to, std::istream& args) {
+             ticks.push_back(std::chrono::system_clock::now());
+             if (ticks.size() == 5) {
+               ASSERT_TRUE(m.Cancel(ticker));
+               m.Exit();
+             }
+           }},
+          {"exit", [&m](const Address& from, const Address& to,
+                        std::istream& args) { m.Exit(); }},
+      }));
+  m.Start();
+
+  // Each tick is due a whole period after the last was due, so lateness
+  // doesn't accumulate
+  ASSERT_EQ(5, ticks.size());
+  for (size_t i = 0; i < ticks.size(); i++) {
+    ASSERT_GE(ticks[i] - start, period * (i + 1));
+  }
+  ASSERT_LT(ticks.back() - start, period * 5 + std::chrono::milliseconds(50));
+}
+
 TEST(MachineTest, Spawn_Local) {
   std::string name("test/Test");
   MockMailbox mailbox;
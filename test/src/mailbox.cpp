@@ -21,12 +21,14 @@ bool MockMailbox::Receive(Address& from, Address& to, std::string& message) {
   return result.result;
 }
 
-void MockMailbox::Send(const Address& to, const std::string& message) {
+void MockMailbox::Send(const Address& to, const std::string& message,
+                       const Priority priority) {
   const auto index = sendArgs_.size();
   SendArgs args;
   args.toIP = to.ip();
   args.toPort = to.port();
   args.message = message;
+  args.priority = priority;
   sendArgs_.push_back(args);
   if (index >= sendResults_.size()) {
     Error() << "Unexpected call to Send" << std::endl;
@@ -68,6 +70,7 @@ void assert_default_mailbox(MockMailbox& mailbox, Address& parent) {
       ASSERT_EQ(parent.ip(), arg0.toIP);
       ASSERT_EQ(parent.port(), arg0.toPort);
       ASSERT_EQ(std::string("started test/Test"), arg0.message);
+      ASSERT_EQ(Priority::kHigh, arg0.priority);
     }
     // Register Machine
     {
@@ -75,6 +78,7 @@ void assert_default_mailbox(MockMailbox& mailbox, Address& parent) {
       ASSERT_EQ(kLocalhost, arg1.toIP);
       ASSERT_EQ(kServerPort, arg1.toPort);
       ASSERT_TRUE(arg1.message.starts_with("register test/Test "));
+      ASSERT_EQ(Priority::kHigh, arg1.priority);
     }
     // Send Exited Message to Spawner
     {
@@ -82,6 +86,7 @@ void assert_default_mailbox(MockMailbox& mailbox, Address& parent) {
       ASSERT_EQ(parent.ip(), arg2.toIP);
       ASSERT_EQ(parent.port(), arg2.toPort);
       ASSERT_EQ(std::string("exited test/Test"), arg2.message);
+      ASSERT_EQ(Priority::kHigh, arg2.priority);
     }
     // Unregister Machine
     {
@@ -89,6 +94,7 @@ void assert_default_mailbox(MockMailbox& mailbox, Address& parent) {
       ASSERT_EQ(kLocalhost, arg3.toIP);
       ASSERT_EQ(kServerPort, arg3.toPort);
       ASSERT_EQ(std::string("unregister"), arg3.message);
+      ASSERT_EQ(Priority::kHigh, arg3.priority);
     }
   }
 }
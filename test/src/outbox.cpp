@@ -0,0 +1,214 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/outbox.h>
+#include <WinkTest/constants.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+TEST(OutboxTest, Push) {
+  Outbox outbox;
+  ASSERT_TRUE(outbox.empty());
+
+  Address to(kLocalhost, kTestPort);
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 0, 0, Address(),
+                            to, kTestMessage});
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 1, 0, Address(),
+                            to, kTestMessage});
+
+  ASSERT_FALSE(outbox.empty());
+  ASSERT_EQ(2, outbox.size());
+  auto it = outbox.begin();
+  ASSERT_EQ(0, it->seq_num);
+  it++;
+  ASSERT_EQ(1, it->seq_num);
+}
+
+TEST(OutboxTest, Size) {
+  Outbox outbox;
+  Address a(kLocalhost, kTestPort);
+  Address b(kLocalhost, kTestPort + 1);
+  ASSERT_EQ(0, outbox.size(a));
+
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 0, 0, Address(),
+                            a, kTestMessage});
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 1, 0, Address(),
+                            a, kTestMessage});
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 0, 0, Address(),
+                            b, kTestMessage});
+  ASSERT_EQ(3, outbox.size());
+  ASSERT_EQ(2, outbox.size(a));
+  ASSERT_EQ(1, outbox.size(b));
+
+  ASSERT_TRUE(outbox.Acknowledge(a, 0));
+  ASSERT_EQ(1, outbox.size(a));
+  ASSERT_TRUE(outbox.Acknowledge(a, 1));
+  ASSERT_EQ(0, outbox.size(a));
+  ASSERT_EQ(1, outbox.size(b));
+}
+
+TEST(OutboxTest, Acknowledge) {
+  Outbox outbox;
+  Address a(kLocalhost, kTestPort);
+  Address b(kLocalhost, kTestPort + 1);
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 0, 0, Address(),
+                            a, kTestMessage});
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 0, 0, Address(),
+                            b, kTestMessage});
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 1, 0, Address(),
+                            a, kTestMessage});
+
+  // Unknown sequence number
+  ASSERT_FALSE(outbox.Acknowledge(a, 2));
+  // Unknown recipient
+  ASSERT_FALSE(outbox.Acknowledge(Address(kTestUnicastIP, kTestPort), 0));
+
+  ASSERT_TRUE(outbox.Acknowledge(a, 0));
+  ASSERT_EQ(2, outbox.size());
+  // Already acknowledged
+  ASSERT_FALSE(outbox.Acknowledge(a, 0));
+
+  // Order of remaining messages is preserved
+  auto it = outbox.begin();
+  ASSERT_EQ(b.port(), it->to.port());
+  ASSERT_EQ(0, it->seq_num);
+  it++;
+  ASSERT_EQ(a.port(), it->to.port());
+  ASSERT_EQ(1, it->seq_num);
+
+  ASSERT_TRUE(outbox.Acknowledge(b, 0));
+  ASSERT_TRUE(outbox.Acknowledge(a, 1));
+  ASSERT_TRUE(outbox.empty());
+}
+
+TEST(OutboxTest, Acknowledge_Range) {
+  Outbox outbox;
+  Address a(kLocalhost, kTestPort);
+  Address b(kLocalhost, kTestPort + 1);
+  for (uint64_t i = 0; i < 8; i++) {
+    outbox.Push(QueuedMessage{std::chrono::system_clock::now(), i, 0,
+                              Address(), a, kTestMessage});
+  }
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 0, 0, Address(),
+                            b, kTestMessage});
+
+  // Acknowledge 0-2 cumulatively, and 4 and 6 selectively
+  std::vector<QueuedMessage> acknowledged;
+  ASSERT_EQ(5, outbox.Acknowledge(a, 2, 0b1010, acknowledged));
+  ASSERT_EQ(5, acknowledged.size());
+  std::vector<uint64_t> seq_nums;
+  for (const auto& m : acknowledged) {
+    seq_nums.push_back(m.seq_num);
+  }
+  ASSERT_EQ(std::vector<uint64_t>({0, 1, 2, 4, 6}), seq_nums);
+  ASSERT_EQ(4, outbox.size());
+
+  // Already acknowledged
+  acknowledged.clear();
+  ASSERT_EQ(0, outbox.Acknowledge(a, 2, 0b1010, acknowledged));
+  ASSERT_TRUE(acknowledged.empty());
+
+  ASSERT_EQ(3, outbox.Acknowledge(a, 7, 0, acknowledged));
+  ASSERT_EQ(1, outbox.size());
+  ASSERT_EQ(b.port(), outbox.begin()->to.port());
+}
+
+TEST(OutboxTest, Acknowledge_Wraparound) {
+  Outbox outbox;
+  Address to(kLocalhost, kTestPort);
+  const uint64_t max = -1;
+  for (const uint64_t seq_num : {max - 1, max, uint64_t(0), uint64_t(1)}) {
+    outbox.Push(QueuedMessage{std::chrono::system_clock::now(), seq_num, 0,
+                              Address(), to, kTestMessage});
+  }
+
+  std::vector<QueuedMessage> acknowledged;
+  ASSERT_EQ(3, outbox.Acknowledge(to, 0, 0, acknowledged));
+  ASSERT_EQ(max - 1, acknowledged[0].seq_num);
+  ASSERT_EQ(max, acknowledged[1].seq_num);
+  ASSERT_EQ(0, acknowledged[2].seq_num);
+  ASSERT_EQ(1, outbox.size());
+  ASSERT_EQ(1, outbox.begin()->seq_num);
+}
+
+TEST(OutboxTest, Erase) {
+  Outbox outbox;
+  Address to(kLocalhost, kTestPort);
+  outbox.Push(QueuedMessage{std::chrono::system_clock::now(), 0, 0, Address(),
+                            to, kTestMessage});
+
+  auto it = outbox.Erase(outbox.begin());
+  ASSERT_EQ(outbox.end(), it);
+  ASSERT_TRUE(outbox.empty());
+  // Erased messages can no longer be acknowledged
+  ASSERT_FALSE(outbox.Acknowledge(to, 0));
+}
+
+TEST(OutboxTest, Due) {
+  Outbox outbox;
+  Address to(kLocalhost, kTestPort);
+  const auto now = std::chrono::system_clock::now();
+  outbox.Push(QueuedMessage{now, 0, 0, Address(), to, kTestMessage});
+  outbox.Push(QueuedMessage{now, 1, 0, Address(), to, kTestMessage});
+  ASSERT_LE(outbox.Next(), now);
+
+  // New messages are due immediately
+  std::vector<Outbox::iterator> due;
+  outbox.Due(now, due);
+  ASSERT_EQ(2, due.size());
+  ASSERT_EQ(0, due[0]->seq_num);
+  ASSERT_EQ(1, due[1]->seq_num);
+  ASSERT_FALSE(outbox.Next());
+
+  // Rescheduled messages are due at their new time
+  outbox.Schedule(due[0], now + kReceiveTimeout);
+  outbox.Schedule(due[1], now + kReceiveTimeout);
+  outbox.Schedule(due[1], now + 2 * kReceiveTimeout);
+  due.clear();
+  outbox.Due(now + kReceiveTimeout + std::chrono::milliseconds(1), due);
+  ASSERT_EQ(1, due.size());
+  ASSERT_EQ(0, due[0]->seq_num);
+
+  // Acknowledged messages are no longer due
+  ASSERT_TRUE(outbox.Acknowledge(to, 1));
+  ASSERT_FALSE(outbox.Next());
+  due.clear();
+  outbox.Due(now + 2 * kReceiveTimeout + std::chrono::milliseconds(1), due);
+  ASSERT_TRUE(due.empty());
+}
+
+TEST(OutboxTest, Window) {
+  Outbox outbox;
+  Address to(kLocalhost, kTestPort);
+  for (uint64_t i = 0; i < kWindowSize + 2; i++) {
+    outbox.Push(QueuedMessage{std::chrono::system_clock::now(), i, 0,
+                              Address(), to, kTestMessage});
+  }
+
+  // Messages beyond the window are held
+  std::vector<Outbox::iterator> due;
+  outbox.Due(std::chrono::system_clock::now(), due);
+  ASSERT_EQ(kWindowSize, due.size());
+  ASSERT_EQ(kWindowSize - 1, due.back()->seq_num);
+  ASSERT_FALSE(outbox.Next());
+
+  // Acknowledging the oldest releases the next
+  ASSERT_TRUE(outbox.Acknowledge(to, 0));
+  due.clear();
+  outbox.Due(std::chrono::system_clock::now(), due);
+  ASSERT_EQ(1, due.size());
+  ASSERT_EQ(kWindowSize, due[0]->seq_num);
+
+  // Acknowledging others doesn't
+  std::vector<QueuedMessage> acknowledged;
+  ASSERT_EQ(1, outbox.Acknowledge(to, 0, 0b10, acknowledged));
+  due.clear();
+  outbox.Due(std::chrono::system_clock::now(), due);
+  ASSERT_TRUE(due.empty());
+
+  ASSERT_EQ(1, outbox.Acknowledge(to, 1, 0, acknowledged));
+  due.clear();
+  outbox.Due(std::chrono::system_clock::now(), due);
+  ASSERT_EQ(1, due.size());
+  ASSERT_EQ(kWindowSize + 1, due[0]->seq_num);
+}
@@ -0,0 +1,81 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/queue.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(MPSCQueueTest, PushPop) {
+  MPSCQueue<std::string> queue(4);
+  ASSERT_TRUE(queue.empty());
+  std::string value;
+  ASSERT_FALSE(queue.TryPop(value));
+
+  for (const auto& v : {"a", "b", "c"}) {
+    std::string s(v);
+    ASSERT_TRUE(queue.TryPush(s));
+  }
+  ASSERT_FALSE(queue.empty());
+  ASSERT_EQ(3, queue.size());
+
+  for (const auto& v : {"a", "b", "c"}) {
+    ASSERT_TRUE(queue.TryPop(value));
+    ASSERT_EQ(v, value);
+  }
+  ASSERT_TRUE(queue.empty());
+  ASSERT_EQ(0, queue.size());
+}
+
+TEST(MPSCQueueTest, Full) {
+  MPSCQueue<int> queue(4);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queue.TryPush(i));
+  }
+  int value = 4;
+  ASSERT_FALSE(queue.TryPush(value));
+  ASSERT_EQ(4, value);
+
+  // Popping makes room, and slots are reused as the queue wraps around
+  for (int i = 0; i < 16; i++) {
+    int popped;
+    ASSERT_TRUE(queue.TryPop(popped));
+    ASSERT_EQ(i, popped);
+    value = i + 4;
+    ASSERT_TRUE(queue.TryPush(value));
+  }
+}
+
+TEST(MPSCQueueTest, Producers) {
+  constexpr int kProducers = 4;
+  constexpr int kValues = 10000;
+  MPSCQueue<int> queue(64);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; p++) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < kValues; i++) {
+        int value = p * kValues + i;
+        while (!queue.TryPush(value)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Values from each producer arrive in the order they were pushed
+  std::vector<int> next(kProducers, 0);
+  for (int received = 0; received < kProducers * kValues;) {
+    int value;
+    if (!queue.TryPop(value)) {
+      std::this_thread::yield();
+      continue;
+    }
+    const auto p = value / kValues;
+    ASSERT_EQ(next[p]++, value % kValues);
+    received++;
+  }
+  for (auto& p : producers) {
+    p.join();
+  }
+  ASSERT_TRUE(queue.empty());
+}
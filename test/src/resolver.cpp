@@ -0,0 +1,89 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/constants.h>
+#include <Wink/resolver.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+TEST(ResolverTest, Resolve) {
+  ASSERT_EQ(kLocalhost, Resolver::Instance().Resolve("localhost"));
+}
+
+TEST(ResolverTest, Resolve_Cached) {
+  std::atomic_int lookups = 0;
+  Resolver resolver(std::chrono::seconds(60), [&](const std::string&) {
+    lookups++;
+    return std::string("10.0.0.1");
+  });
+  ASSERT_EQ("10.0.0.1", resolver.Resolve("peer"));
+  ASSERT_EQ("10.0.0.1", resolver.Resolve("peer"));
+  ASSERT_EQ(1, lookups);
+  ASSERT_EQ("10.0.0.1", resolver.Resolve("other"));
+  ASSERT_EQ(2, lookups);
+  ASSERT_EQ(2, resolver.size());
+}
+
+TEST(ResolverTest, Resolve_Refresh) {
+  std::atomic_int lookups = 0;
+  Resolver resolver(std::chrono::milliseconds(50), [&](const std::string&) {
+    return "10.0.0." + std::to_string(++lookups);
+  });
+  ASSERT_EQ("10.0.0.1", resolver.Resolve("peer"));
+
+  // Expired entries are refreshed in the background while in use, and lookups
+  // return the previous address until then
+  std::string ip;
+  for (int i = 0; i < 100 && ip != "10.0.0.2"; i++) {
+    ip = resolver.Resolve("peer");
+    ASSERT_TRUE(ip == "10.0.0.1" || ip == "10.0.0.2");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ("10.0.0.2", ip);
+}
+
+TEST(ResolverTest, Resolve_Unused) {
+  std::atomic_int lookups = 0;
+  Resolver resolver(std::chrono::milliseconds(20), [&](const std::string&) {
+    lookups++;
+    return std::string("10.0.0.1");
+  });
+  resolver.Resolve("peer");
+  ASSERT_EQ(1, resolver.size());
+
+  // Entries not used since they were resolved are forgotten once they expire
+  for (int i = 0; i < 100 && resolver.size() > 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(0, resolver.size());
+  ASSERT_EQ(1, lookups);
+}
+
+TEST(ResolverTest, Resolve_Failed) {
+  std::atomic_int lookups = 0;
+  Resolver resolver(std::chrono::milliseconds(50), [&](const std::string& h) {
+    // Only the first and third lookups succeed
+    return ++lookups % 2 == 0 ? h : std::string("10.0.0.1");
+  });
+  ASSERT_EQ("10.0.0.1", resolver.Resolve("peer"));
+
+  // Failed refresh keeps the previous address
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ("10.0.0.1", resolver.Resolve("peer"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  ASSERT_GE(lookups, 2);
+
+  // Failed lookups aren't cached, so the next lookup tries again
+  Resolver failing(std::chrono::seconds(60), [&](const std::string& h) {
+    lookups++;
+    return h;
+  });
+  lookups = 0;
+  ASSERT_EQ("peer", failing.Resolve("peer"));
+  ASSERT_EQ("peer", failing.Resolve("peer"));
+  ASSERT_EQ(2, lookups);
+  ASSERT_EQ(0, failing.size());
+}
@@ -0,0 +1,195 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/ring.h>
+#include <WinkTest/constants.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr char kTestRing[] = "/wink-test-ring";
+
+TEST(SharedMemoryRingTest, PushPop) {
+  SharedMemoryRing ring(kTestRing);
+  ASSERT_TRUE(ring.empty());
+
+  const auto opened = SharedMemoryRing::Open(kTestRing);
+  ASSERT_NE(nullptr, opened);
+  Address from(kLocalhost, kTestPort);
+  ASSERT_TRUE(opened->Push(from, kTestMessage.data(), kTestMessage.length()));
+  ASSERT_TRUE(opened->Push(from, "second", 6));
+  ASSERT_FALSE(ring.empty());
+
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> datagrams(kMaxBatchSize);
+  for (size_t i = 0; i < kMaxBatchSize; i++) {
+    datagrams[i].buffer = &buffers[i * kMaxUDPPayload];
+  }
+  Address to(kLocalhost, kTestPort + 1);
+  ASSERT_EQ(2, ring.Pop(datagrams, to));
+  ASSERT_EQ(from, datagrams[0].from);
+  ASSERT_EQ(to, datagrams[0].to);
+  ASSERT_EQ(kTestMessage,
+            std::string(datagrams[0].buffer, datagrams[0].length));
+  ASSERT_EQ("second", std::string(datagrams[1].buffer, datagrams[1].length));
+  ASSERT_TRUE(ring.empty());
+  ASSERT_EQ(0, ring.Pop(datagrams, to));
+}
+
+TEST(SharedMemoryRingTest, Open_Missing) {
+  ASSERT_EQ(nullptr, SharedMemoryRing::Open(kTestRing));
+}
+
+TEST(SharedMemoryRingTest, Closed) {
+  auto ring = std::make_unique<SharedMemoryRing>(kTestRing);
+  const auto opened = SharedMemoryRing::Open(kTestRing);
+  ASSERT_NE(nullptr, opened);
+  ASSERT_FALSE(opened->closed());
+
+  ring.reset();
+  ASSERT_TRUE(opened->closed());
+  ASSERT_FALSE(opened->Push(Address(), kTestMessage.data(),
+                            kTestMessage.length()));
+  ASSERT_EQ(nullptr, SharedMemoryRing::Open(kTestRing));
+}
+
+TEST(SharedMemoryRingTest, Full) {
+  SharedMemoryRing ring(kTestRing);
+  const auto opened = SharedMemoryRing::Open(kTestRing);
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> datagrams(kMaxBatchSize);
+  for (size_t i = 0; i < kMaxBatchSize; i++) {
+    datagrams[i].buffer = &buffers[i * kMaxUDPPayload];
+  }
+
+  // Fill the ring, then keep it busy across the end so datagrams wrap around
+  const std::string payload(kMaxUDPPayload, 'x');
+  size_t pushed = 0;
+  while (opened->Push(Address(), payload.data(), payload.length())) {
+    pushed++;
+  }
+  ASSERT_GT(pushed, 0);
+  ASSERT_LT(pushed, kSharedMemoryRingSize / kMaxUDPPayload + 1);
+  for (size_t round = 0; round < 3 * pushed; round++) {
+    datagrams.resize(1);
+    ASSERT_EQ(1, ring.Pop(datagrams, Address()));
+    ASSERT_EQ(payload.length(), datagrams[0].length);
+    ASSERT_TRUE(opened->Push(Address(), payload.data(), payload.length()));
+  }
+}
+
+TEST(SharedMemoryRingTest, Sleep) {
+  SharedMemoryRing ring(kTestRing);
+  const auto opened = SharedMemoryRing::Open(kTestRing);
+
+  // Nobody to wake
+  ASSERT_FALSE(opened->Wake());
+
+  ASSERT_TRUE(ring.Sleep());
+  ASSERT_TRUE(opened->Push(Address(), kTestMessage.data(),
+                           kTestMessage.length()));
+  ASSERT_TRUE(opened->Wake());
+  // Only woken once
+  ASSERT_FALSE(opened->Wake());
+  ring.Awake();
+
+  // Doesn't sleep while there are datagrams to pop
+  ASSERT_FALSE(ring.Sleep());
+  ASSERT_FALSE(opened->Wake());
+}
+
+TEST(SharedMemoryRingTest, Open_DeadOwner) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Child dies without closing its ring
+    new SharedMemoryRing(kTestRing);
+    _exit(0);
+  }
+  ASSERT_GT(pid, 0);
+  ASSERT_EQ(pid, waitpid(pid, nullptr, 0));
+
+  // Orphaned ring is never trusted, and is removed
+  ASSERT_EQ(nullptr, SharedMemoryRing::Open(kTestRing));
+  const int fd = shm_open(kTestRing, O_RDWR, 0);
+  ASSERT_LT(fd, 0);
+}
+
+TEST(SharedMemoryRingTest, Alive) {
+  int ready[2];
+  ASSERT_EQ(0, pipe(ready));
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Child owns the ring until it is killed
+    new SharedMemoryRing(kTestRing);
+    if (write(ready[1], "", 1) == 1) {
+      pause();
+    }
+    _exit(0);
+  }
+  ASSERT_GT(pid, 0);
+  char c;
+  ASSERT_EQ(1, read(ready[0], &c, 1));
+  close(ready[0]);
+  close(ready[1]);
+
+  const auto opened = SharedMemoryRing::Open(kTestRing);
+  ASSERT_NE(nullptr, opened);
+  ASSERT_TRUE(opened->alive());
+
+  kill(pid, SIGKILL);
+  ASSERT_EQ(pid, waitpid(pid, nullptr, 0));
+  ASSERT_FALSE(opened->alive());
+  ASSERT_TRUE(opened->closed());
+  ASSERT_EQ(nullptr, SharedMemoryRing::Open(kTestRing));
+}
+
+TEST(SharedMemoryRingTest, Push_TooLong) {
+  SharedMemoryRing ring(kTestRing);
+  const auto opened = SharedMemoryRing::Open(kTestRing);
+  const std::string payload(kMaxUDPPayload + 1, 'x');
+  ASSERT_FALSE(opened->Push(Address(), payload.data(), payload.length()));
+  ASSERT_TRUE(ring.empty());
+}
+
+TEST(SharedMemoryRingTest, Pop_Corrupt) {
+  SharedMemoryRing ring(kTestRing);
+  const auto opened = SharedMemoryRing::Open(kTestRing);
+  const std::string marker("wink-corrupt-record");
+  ASSERT_TRUE(opened->Push(Address(), marker.data(), marker.length()));
+
+  // Overwrite the record's length, which precedes its payload, as a sender
+  // dying mid-write might
+  const int fd = shm_open(kTestRing, O_RDWR, 0);
+  ASSERT_GE(fd, 0);
+  struct stat status = {};
+  ASSERT_EQ(0, fstat(fd, &status));
+  char* mapping = static_cast<char*>(mmap(nullptr, status.st_size,
+                                          PROT_READ | PROT_WRITE, MAP_SHARED,
+                                          fd, 0));
+  close(fd);
+  ASSERT_NE(MAP_FAILED, mapping);
+  const std::string_view memory(mapping, status.st_size);
+  const auto payload = memory.find(marker);
+  ASSERT_NE(std::string_view::npos, payload);
+  const uint32_t length = kMaxUDPPayload + 1;
+  std::memcpy(mapping + payload - 3 * sizeof(uint32_t), &length,
+              sizeof(length));
+  munmap(mapping, status.st_size);
+
+  // Corrupt record isn't copied, and closes the ring
+  std::vector<char> buffer(kMaxUDPPayload);
+  std::vector<Datagram> datagrams(1);
+  datagrams[0].buffer = buffer.data();
+  ASSERT_EQ(0, ring.Pop(datagrams, Address()));
+  ASSERT_TRUE(ring.empty());
+  ASSERT_TRUE(opened->closed());
+  ASSERT_FALSE(opened->Push(Address(), marker.data(), marker.length()));
+}
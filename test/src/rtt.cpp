@@ -0,0 +1,51 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/rtt.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+TEST(RoundTripTest, Initial) {
+  RoundTrip rt;
+  ASSERT_EQ(0, rt.samples());
+  ASSERT_EQ(kInitialRetransmitTimeout, rt.Timeout());
+}
+
+TEST(RoundTripTest, Sample) {
+  RoundTrip rt;
+  rt.Sample(milliseconds(100));
+  ASSERT_EQ(1, rt.samples());
+  ASSERT_EQ(milliseconds(100), rt.smoothed());
+  ASSERT_EQ(milliseconds(50), rt.variance());
+  ASSERT_EQ(milliseconds(300), rt.Timeout());
+
+  // Converges on a steady round trip time
+  for (int i = 0; i < 100; i++) {
+    rt.Sample(milliseconds(250));
+  }
+  ASSERT_EQ(101, rt.samples());
+  ASSERT_NEAR(250000, rt.smoothed().count(), 100);
+  ASSERT_LT(rt.variance(), milliseconds(1));
+  ASSERT_LT(rt.Timeout(), milliseconds(255));
+}
+
+TEST(RoundTripTest, Timeout_Clamped) {
+  RoundTrip fast;
+  fast.Sample(microseconds(50));
+  ASSERT_EQ(kMinRetransmitTimeout, fast.Timeout());
+
+  RoundTrip slow;
+  slow.Sample(kMaxRetransmitTimeout);
+  ASSERT_EQ(kMaxRetransmitTimeout, slow.Timeout());
+}
+
+TEST(RoundTripTest, Timeout_Backoff) {
+  RoundTrip rt;
+  rt.Sample(milliseconds(100));
+  ASSERT_EQ(milliseconds(300), rt.Timeout(1));
+  ASSERT_EQ(milliseconds(600), rt.Timeout(2));
+  ASSERT_EQ(milliseconds(1200), rt.Timeout(3));
+  ASSERT_EQ(kMaxRetransmitTimeout, rt.Timeout(20));
+}
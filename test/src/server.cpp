@@ -62,6 +62,35 @@ TEST(ServerTest, Registration) {
   worker.join();
 }
 
+TEST(ServerTest, Start_InvalidAddress) {
+  Address server_address(kLocalhost, kServerPort);
+  UDPSocket server_socket(server_address);
+  AsyncMailbox server_mailbox(server_socket);
+  Server server(server_address, server_mailbox);
+
+  std::thread worker{[&server] { server.Serve("../../samples/"); }};
+
+  Address client_address(kLocalhost, 0);
+  UDPSocket client_socket(client_address);
+  AsyncMailbox client_mailbox(client_socket);
+
+  // Addresses that can't be parsed are rejected without bringing down the
+  // server
+  client_mailbox.Send(server_address, "start foo wink.invalid:1");
+  client_mailbox.Send(server_address, "start foo :99999999999999999999");
+
+  client_mailbox.Send(server_address, "list");
+  Address from;
+  Address to;
+  std::string message;
+  ASSERT_TRUE(client_mailbox.Receive(from, to, message));
+  ASSERT_EQ(server_address, from);
+  ASSERT_EQ("Port,PID,Machine", message);
+
+  server.Shutdown();
+  worker.join();
+}
+
 TEST(ServerTest, StartListStop) {
   Address server_address(kLocalhost, kServerPort);
   UDPSocket server_socket(server_address);
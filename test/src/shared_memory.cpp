@@ -0,0 +1,193 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/mailbox.h>
+#include <Wink/socket.h>
+#include <WinkTest/constants.h>
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(SharedMemorySocketTest, SendReceive) {
+  Address sender_address(kLocalhost, 0);
+  SharedMemorySocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  SharedMemorySocket receiver_socket(receiver_address);
+
+  ASSERT_TRUE(sender_socket.Send(receiver_address, kTestMessage.data(),
+                                 kTestMessage.length()));
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(receiver_address, to);
+  ASSERT_EQ(kTestMessage, std::string(buffer, length));
+}
+
+TEST(SharedMemorySocketTest, ReceiveBatch) {
+  Address shared_address(kLocalhost, 0);
+  SharedMemorySocket shared_socket(shared_address);
+  Address udp_address(kLocalhost, 0);
+  UDPSocket udp_socket(udp_address);
+  Address receiver_address(kLocalhost, 0);
+  SharedMemorySocket receiver_socket(receiver_address);
+
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> incoming(kMaxBatchSize);
+  const auto receive = [&]() {
+    for (size_t i = 0; i < kMaxBatchSize; i++) {
+      incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+    }
+    return receiver_socket.ReceiveBatch(incoming);
+  };
+
+  // Received from both shared memory and the network
+  ASSERT_TRUE(shared_socket.Send(receiver_address, "shared", 6));
+  ASSERT_TRUE(udp_socket.Send(receiver_address, "udp", 3));
+  std::vector<std::string> messages;
+  while (messages.size() < 2) {
+    const auto count = receive();
+    ASSERT_GT(count, 0);
+    for (size_t i = 0; i < count; i++) {
+      messages.emplace_back(incoming[i].buffer, incoming[i].length);
+    }
+  }
+  std::sort(messages.begin(), messages.end());
+  ASSERT_EQ(std::vector<std::string>({"shared", "udp"}), messages);
+
+  // Sleeping receiver is woken by shared memory
+  std::thread sender([&] {
+    sleep(1);
+    shared_socket.Send(receiver_address, kTestMessage.data(),
+                       kTestMessage.length());
+  });
+  const auto start = std::chrono::steady_clock::now();
+  size_t count = 0;
+  while (count == 0) {
+    count = receive();
+  }
+  ASSERT_LT(std::chrono::steady_clock::now() - start, kReceiveTimeout);
+  ASSERT_EQ(1, count);
+  ASSERT_EQ(shared_address, incoming[0].from);
+  ASSERT_EQ(kTestMessage, std::string(incoming[0].buffer, incoming[0].length));
+  sender.join();
+}
+
+TEST(SharedMemorySocketTest, Fallback) {
+  // Peers without shared memory are sent to over the network
+  Address sender_address(kLocalhost, 0);
+  SharedMemorySocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address);
+
+  ASSERT_TRUE(sender_socket.Send(receiver_address, kTestMessage.data(),
+                                 kTestMessage.length()));
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(kTestMessage, std::string(buffer, length));
+}
+
+TEST(SharedMemorySocketTest, Mailbox) {
+  Address receiver_address(kLocalhost, 0);
+  SharedMemorySocket receiver_socket(receiver_address);
+  AsyncMailbox receiver_mailbox(receiver_socket);
+  Address sender_address(kLocalhost, 0);
+  SharedMemorySocket sender_socket(sender_address);
+  AsyncMailbox sender_mailbox(sender_socket);
+
+  sender_mailbox.Send(receiver_address, kTestMessage);
+
+  Address from;
+  Address to;
+  std::string message;
+  ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(receiver_address, to);
+  ASSERT_EQ(kTestMessage, message);
+  ASSERT_TRUE(sender_mailbox.Flushed());
+}
+
+TEST(SharedMemorySocketTest, Full) {
+  Address sender_address(kLocalhost, 0);
+  SharedMemorySocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  SharedMemorySocket receiver_socket(receiver_address);
+
+  const auto payload = [](const size_t i) {
+    auto p = std::to_string(i);
+    p.resize(kMaxUDPPayload / 2, ' ');
+    return p;
+  };
+
+  // Sends fail once the ring is full, rather than overtake it over the
+  // network
+  size_t sent = 0;
+  while (true) {
+    const auto p = payload(sent);
+    if (!sender_socket.Send(receiver_address, p.data(), p.length())) {
+      break;
+    }
+    sent++;
+  }
+  ASSERT_GT(sent, 0);
+
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> incoming(kMaxBatchSize);
+  size_t received = 0;
+  while (received < sent) {
+    for (size_t i = 0; i < kMaxBatchSize; i++) {
+      incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+    }
+    const auto count = receiver_socket.ReceiveBatch(incoming);
+    ASSERT_GT(count, 0);
+    for (size_t i = 0; i < count; i++) {
+      ASSERT_EQ(payload(received++),
+                std::string(incoming[i].buffer, incoming[i].length));
+    }
+  }
+  ASSERT_EQ(sent, received);
+
+  // Room is made as the receiver catches up
+  const auto p = payload(sent);
+  ASSERT_TRUE(sender_socket.Send(receiver_address, p.data(), p.length()));
+}
+
+TEST(SharedMemorySocketTest, DeadPeer) {
+  Address receiver_address(kLocalhost, kTestPort);
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Child dies without closing its ring
+    new SharedMemorySocket(receiver_address);
+    _exit(0);
+  }
+  ASSERT_GT(pid, 0);
+  ASSERT_EQ(pid, waitpid(pid, nullptr, 0));
+
+  // Port is taken by a peer only using the network, which is sent to over the
+  // network rather than through the orphaned ring
+  UDPSocket receiver_socket(receiver_address);
+  Address sender_address(kLocalhost, 0);
+  SharedMemorySocket sender_socket(sender_address);
+  ASSERT_TRUE(sender_socket.Send(receiver_address, kTestMessage.data(),
+                                 kTestMessage.length()));
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(kTestMessage, std::string(buffer, length));
+}
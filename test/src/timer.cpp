@@ -0,0 +1,149 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/timer.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+using std::chrono::hours;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+TEST(TimerWheelTest, Advance) {
+  const auto origin = std::chrono::system_clock::now();
+  TimerWheel<int> wheel(origin);
+  ASSERT_TRUE(wheel.empty());
+  ASSERT_FALSE(wheel.Next());
+
+  wheel.Schedule(origin + milliseconds(30), 3);
+  wheel.Schedule(origin + milliseconds(10), 1);
+  wheel.Schedule(origin + milliseconds(20), 2);
+  ASSERT_EQ(3, wheel.size());
+  ASSERT_EQ(origin + milliseconds(10), wheel.Next());
+
+  std::vector<int> expired;
+  wheel.Advance(origin + milliseconds(9), expired);
+  ASSERT_TRUE(expired.empty());
+
+  wheel.Advance(origin + milliseconds(25), expired);
+  ASSERT_EQ(std::vector<int>({1, 2}), expired);
+  ASSERT_EQ(origin + milliseconds(30), wheel.Next());
+
+  expired.clear();
+  wheel.Advance(origin + milliseconds(30), expired);
+  ASSERT_EQ(std::vector<int>({3}), expired);
+  ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, Advance_Levels) {
+  const auto origin = std::chrono::system_clock::now();
+  TimerWheel<int> wheel(origin);
+
+  // Deadlines spanning every level, plus one beyond the top level
+  const std::vector<std::chrono::system_clock::duration> delays = {
+      milliseconds(5), milliseconds(100), seconds(10), hours(2), hours(24 * 7)};
+  for (size_t i = 0; i < delays.size(); i++) {
+    wheel.Schedule(origin + delays[i], i);
+  }
+
+  std::vector<int> expired;
+  for (size_t i = 0; i < delays.size(); i++) {
+    // Not early
+    wheel.Advance(origin + delays[i] - milliseconds(1), expired);
+    ASSERT_EQ(i, expired.size());
+    ASSERT_LE(wheel.Next(), origin + delays[i]);
+    // Not late
+    wheel.Advance(origin + delays[i], expired);
+    ASSERT_EQ(i + 1, expired.size());
+    ASSERT_EQ(i, expired.back());
+  }
+  ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, Advance_Microseconds) {
+  const auto origin = std::chrono::system_clock::now();
+  TimerWheel<int, microseconds> wheel(origin);
+
+  // Deadlines within a millisecond, plus one beyond the top level
+  wheel.Schedule(origin + microseconds(250), 1);
+  wheel.Schedule(origin + microseconds(750), 2);
+  wheel.Schedule(origin + seconds(60), 3);
+  ASSERT_LE(wheel.Next(), origin + microseconds(250));
+
+  std::vector<int> expired;
+  wheel.Advance(origin + microseconds(249), expired);
+  ASSERT_TRUE(expired.empty());
+  wheel.Advance(origin + microseconds(250), expired);
+  ASSERT_EQ(std::vector<int>({1}), expired);
+  wheel.Advance(origin + microseconds(750), expired);
+  ASSERT_EQ(std::vector<int>({1, 2}), expired);
+  wheel.Advance(origin + seconds(60) - microseconds(1), expired);
+  ASSERT_EQ(2, expired.size());
+  wheel.Advance(origin + seconds(60), expired);
+  ASSERT_EQ(std::vector<int>({1, 2, 3}), expired);
+}
+
+TEST(TimerWheelTest, Schedule_Past) {
+  const auto origin = std::chrono::system_clock::now();
+  TimerWheel<int> wheel(origin);
+
+  std::vector<int> expired;
+  wheel.Advance(origin + seconds(1), expired);
+  wheel.Schedule(origin, 1);
+  wheel.Advance(origin + seconds(1), expired);
+  ASSERT_TRUE(expired.empty());
+  wheel.Advance(origin + seconds(1) + milliseconds(1), expired);
+  ASSERT_EQ(std::vector<int>({1}), expired);
+}
+
+TEST(TimerWheelTest, Cancel) {
+  const auto origin = std::chrono::system_clock::now();
+  TimerWheel<int> wheel(origin);
+
+  const auto a = wheel.Schedule(origin + milliseconds(10), 1);
+  const auto b = wheel.Schedule(origin + seconds(10), 2);
+  ASSERT_TRUE(wheel.Cancel(a));
+  ASSERT_FALSE(wheel.Cancel(a));
+  ASSERT_EQ(1, wheel.size());
+
+  // Cancel after cascading to a lower level
+  std::vector<int> expired;
+  wheel.Advance(origin + seconds(9), expired);
+  ASSERT_TRUE(expired.empty());
+  ASSERT_TRUE(wheel.Cancel(b));
+  wheel.Advance(origin + seconds(11), expired);
+  ASSERT_TRUE(expired.empty());
+  ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, Advance_Random) {
+  const auto origin = std::chrono::system_clock::now();
+  TimerWheel<std::chrono::system_clock::time_point> wheel(origin);
+
+  std::srand(42);
+  auto now = origin;
+  size_t scheduled = 0;
+  size_t expired_count = 0;
+  for (int i = 0; i < 1000; i++) {
+    for (int j = 0; j < 10; j++) {
+      const auto deadline = now + milliseconds(std::rand() % 1000000);
+      wheel.Schedule(deadline, deadline);
+      scheduled++;
+    }
+    const auto previous = now;
+    now += milliseconds(std::rand() % 10000);
+    std::vector<std::chrono::system_clock::time_point> expired;
+    wheel.Advance(now, expired);
+    for (const auto& deadline : expired) {
+      ASSERT_LE(deadline, now);
+      ASSERT_GT(deadline, previous);
+    }
+    expired_count += expired.size();
+    if (const auto next = wheel.Next(); next) {
+      ASSERT_GT(*next, now);
+    }
+  }
+  ASSERT_EQ(scheduled, expired_count + wheel.size());
+}
@@ -0,0 +1,213 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/socket.h>
+#include <WinkTest/constants.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(UDPSocketTest, Batch) {
+  Address sender_address(kLocalhost, 0);
+  UDPSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address);
+
+  std::vector<std::string> payloads = {"first", "second", "third"};
+  std::vector<Datagram> outgoing(payloads.size());
+  for (size_t i = 0; i < payloads.size(); i++) {
+    outgoing[i].to = receiver_address;
+    outgoing[i].buffer = payloads[i].data();
+    outgoing[i].length = payloads[i].length();
+  }
+  ASSERT_EQ(payloads.size(),
+            sender_socket.SendBatch(outgoing, outgoing.size()));
+
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> incoming(kMaxBatchSize);
+  std::vector<std::string> messages;
+  while (messages.size() < payloads.size()) {
+    for (size_t i = 0; i < kMaxBatchSize; i++) {
+      incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+    }
+    const auto count = receiver_socket.ReceiveBatch(incoming);
+    ASSERT_GT(count, 0);
+    for (size_t i = 0; i < count; i++) {
+      const auto& d = incoming[i];
+      ASSERT_EQ(sender_address, d.from);
+      ASSERT_EQ(receiver_address, d.to);
+      messages.emplace_back(d.buffer, d.length);
+    }
+  }
+  ASSERT_EQ(payloads, messages);
+}
+
+// Returns enough payloads of the same size to be coalesced, and a smaller last
+std::vector<std::string> CoalescablePayloads() {
+  std::vector<std::string> payloads;
+  for (size_t i = 0; i < 2 * kMaxBatchSize; i++) {
+    payloads.push_back(std::string(99, 'a' + i % 26) + std::to_string(i % 10));
+  }
+  payloads.push_back("last");
+  return payloads;
+}
+
+TEST(UDPSocketTest, Batch_Coalesced) {
+  Address sender_address(kLocalhost, 0);
+  UDPSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address);
+
+  auto payloads = CoalescablePayloads();
+  std::vector<Datagram> outgoing(payloads.size());
+  for (size_t i = 0; i < payloads.size(); i++) {
+    outgoing[i].to = receiver_address;
+    outgoing[i].buffer = payloads[i].data();
+    outgoing[i].length = payloads[i].length();
+  }
+  ASSERT_EQ(payloads.size(),
+            sender_socket.SendBatch(outgoing, outgoing.size()));
+
+  // Split back into datagrams in the order they were sent, over several
+  // batches smaller than the coalesced datagrams
+  const size_t batch = 5;
+  std::vector<char> buffers(batch * kMaxUDPPayload);
+  std::vector<Datagram> incoming(batch);
+  std::vector<std::string> messages;
+  while (messages.size() < payloads.size()) {
+    for (size_t i = 0; i < batch; i++) {
+      incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+    }
+    const auto count = receiver_socket.ReceiveBatch(incoming);
+    ASSERT_GT(count, 0);
+    for (size_t i = 0; i < count; i++) {
+      const auto& d = incoming[i];
+      ASSERT_EQ(sender_address, d.from);
+      ASSERT_EQ(receiver_address, d.to);
+      messages.emplace_back(d.buffer, d.length);
+    }
+  }
+  ASSERT_EQ(payloads, messages);
+}
+
+TEST(UDPSocketTest, Receive_Coalesced) {
+  Address sender_address(kLocalhost, 0);
+  UDPSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address);
+
+  auto payloads = CoalescablePayloads();
+  std::vector<Datagram> outgoing(payloads.size());
+  for (size_t i = 0; i < payloads.size(); i++) {
+    outgoing[i].to = receiver_address;
+    outgoing[i].buffer = payloads[i].data();
+    outgoing[i].length = payloads[i].length();
+  }
+  ASSERT_EQ(payloads.size(),
+            sender_socket.SendBatch(outgoing, outgoing.size()));
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  for (const auto& payload : payloads) {
+    ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+    ASSERT_EQ(sender_address, from);
+    ASSERT_EQ(receiver_address, to);
+    ASSERT_EQ(payload, std::string(buffer, length));
+  }
+}
+
+TEST(UDPSocketTest, ReceiveBatch_Multicast) {
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address);
+  // Join many groups, so a receiver polling each in turn would be slow
+  std::vector<Address> groups;
+  for (uint16_t i = 0; i < 10; i++) {
+    groups.emplace_back(kTestMulticastIP, kTestPort + i);
+    ASSERT_TRUE(receiver_socket.JoinGroup(groups.back()));
+  }
+
+  Address sender_address(kLocalhost, 0);
+  UDPSocket sender_socket(sender_address);
+  ASSERT_TRUE(sender_socket.Send(groups.back(), kTestMessage.c_str(),
+                                 kTestMessage.length()));
+
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> incoming(kMaxBatchSize);
+  for (size_t i = 0; i < kMaxBatchSize; i++) {
+    incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+  }
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(1, receiver_socket.ReceiveBatch(incoming));
+  ASSERT_LT(std::chrono::steady_clock::now() - start, kReceiveTimeout);
+  ASSERT_EQ(groups.back(), incoming[0].to);
+  ASSERT_EQ(kTestMessage, std::string(incoming[0].buffer, incoming[0].length));
+
+  // Packets from left groups are no longer received
+  ASSERT_TRUE(receiver_socket.LeaveGroup(groups.back()));
+  ASSERT_TRUE(sender_socket.Send(groups.back(), kTestMessage.c_str(),
+                                 kTestMessage.length()));
+  ASSERT_EQ(0, receiver_socket.ReceiveBatch(incoming));
+}
+
+TEST(UDPSocketTest, ReceiveShard) {
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address, 4);
+  ASSERT_EQ(4, receiver_socket.Shards());
+
+  // Each sender sends from its own port, so lands on its own shard
+  // Sockets refer to their addresses, which mustn't move
+  std::deque<Address> sender_addresses;
+  std::vector<std::unique_ptr<UDPSocket>> sender_sockets;
+  const std::vector<std::string> payloads = {"first", "second", "third"};
+  for (size_t i = 0; i < 8; i++) {
+    auto& sender_address = sender_addresses.emplace_back(kLocalhost, 0);
+    auto& sender_socket = sender_sockets.emplace_back(
+        std::make_unique<UDPSocket>(sender_address));
+    for (const auto& p : payloads) {
+      ASSERT_TRUE(sender_socket->Send(receiver_address, p.c_str(), p.length()));
+    }
+  }
+  const auto expected = sender_addresses.size() * payloads.size();
+
+  std::mutex mutex;
+  std::map<Address, std::vector<std::string>> messages;
+  std::map<Address, std::vector<size_t>> shards;
+  std::atomic_size_t received = 0;
+  std::vector<std::thread> receivers;
+  for (size_t shard = 0; shard < receiver_socket.Shards(); shard++) {
+    receivers.emplace_back([&, shard] {
+      std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+      std::vector<Datagram> incoming(kMaxBatchSize);
+      while (received < expected) {
+        for (size_t i = 0; i < kMaxBatchSize; i++) {
+          incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+        }
+        const auto count = receiver_socket.ReceiveShard(incoming, shard);
+        std::scoped_lock lock(mutex);
+        for (size_t i = 0; i < count; i++) {
+          const auto& d = incoming[i];
+          messages[d.from].emplace_back(d.buffer, d.length);
+          shards[d.from].push_back(shard);
+        }
+        received += count;
+      }
+    });
+  }
+  for (auto& r : receivers) {
+    r.join();
+  }
+
+  ASSERT_EQ(expected, received);
+  for (const auto& sender_address : sender_addresses) {
+    ASSERT_EQ(payloads, messages[sender_address]);
+    const auto& s = shards[sender_address];
+    ASSERT_EQ(std::vector<size_t>(s.size(), s.front()), s);
+  }
+}
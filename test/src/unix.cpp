@@ -0,0 +1,231 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/mailbox.h>
+#include <Wink/socket.h>
+#include <WinkTest/constants.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(UnixSocketTest, SendReceive) {
+  Address sender_address(kLocalhost, 0);
+  UnixSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  UnixSocket receiver_socket(receiver_address);
+
+  ASSERT_TRUE(sender_socket.Reliable(receiver_address));
+  ASSERT_TRUE(sender_socket.Send(receiver_address, kTestMessage.data(),
+                                 kTestMessage.length()));
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(receiver_address, to);
+  ASSERT_EQ(kTestMessage, std::string(buffer, length));
+}
+
+TEST(UnixSocketTest, ReceiveBatch) {
+  Address unix_address(kLocalhost, 0);
+  UnixSocket unix_socket(unix_address);
+  Address udp_address(kLocalhost, 0);
+  UDPSocket udp_socket(udp_address);
+  Address receiver_address(kLocalhost, 0);
+  UnixSocket receiver_socket(receiver_address);
+
+  std::vector<char> buffers(kMaxBatchSize * kMaxUDPPayload);
+  std::vector<Datagram> incoming(kMaxBatchSize);
+  const auto receive = [&]() {
+    for (size_t i = 0; i < kMaxBatchSize; i++) {
+      incoming[i].buffer = &buffers[i * kMaxUDPPayload];
+    }
+    return receiver_socket.ReceiveBatch(incoming);
+  };
+
+  // Received from both the Unix socket and the network
+  ASSERT_TRUE(unix_socket.Send(receiver_address, "unix", 4));
+  ASSERT_TRUE(udp_socket.Send(receiver_address, "udp", 3));
+  std::map<std::string, Address> messages;
+  while (messages.size() < 2) {
+    const auto count = receive();
+    ASSERT_GT(count, 0);
+    for (size_t i = 0; i < count; i++) {
+      messages[std::string(incoming[i].buffer, incoming[i].length)] =
+          incoming[i].from;
+    }
+  }
+  ASSERT_EQ((std::map<std::string, Address>{{"udp", udp_address},
+                                            {"unix", unix_address}}),
+            messages);
+
+  // Waiting receiver is woken by the Unix socket
+  std::thread sender([&] {
+    sleep(1);
+    unix_socket.Send(receiver_address, kTestMessage.data(),
+                     kTestMessage.length());
+  });
+  const auto start = std::chrono::steady_clock::now();
+  size_t count = 0;
+  while (count == 0) {
+    count = receive();
+  }
+  ASSERT_LT(std::chrono::steady_clock::now() - start, kReceiveTimeout);
+  ASSERT_EQ(1, count);
+  ASSERT_EQ(unix_address, incoming[0].from);
+  ASSERT_EQ(kTestMessage, std::string(incoming[0].buffer, incoming[0].length));
+  sender.join();
+}
+
+TEST(UnixSocketTest, Fallback) {
+  // Peers without a Unix socket are sent to over the network
+  Address sender_address(kLocalhost, 0);
+  UnixSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  UDPSocket receiver_socket(receiver_address);
+
+  ASSERT_FALSE(sender_socket.Reliable(receiver_address));
+  ASSERT_TRUE(sender_socket.Send(receiver_address, kTestMessage.data(),
+                                 kTestMessage.length()));
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(kTestMessage, std::string(buffer, length));
+}
+
+TEST(UnixSocketTest, Mailbox) {
+  Address receiver_address(kLocalhost, 0);
+  UnixSocket receiver_socket(receiver_address);
+  AsyncMailbox receiver_mailbox(receiver_socket);
+  Address sender_address(kLocalhost, 0);
+  UnixSocket sender_socket(sender_address);
+  AsyncMailbox sender_mailbox(sender_socket);
+
+  sender_mailbox.Send(receiver_address, kTestMessage);
+
+  Address from;
+  Address to;
+  std::string message;
+  ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(receiver_address, to);
+  ASSERT_EQ(kTestMessage, message);
+  ASSERT_TRUE(sender_mailbox.Flushed());
+  // Message was neither acknowledged nor retransmitted, so the round trip was
+  // never measured
+  ASSERT_TRUE(sender_mailbox.RoundTrips().empty());
+}
+
+std::string TestUnixPath(const std::string& name) {
+  const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+  return std::string(runtime ? runtime : "/tmp") + "/wink/" + name;
+}
+
+TEST(UnixSocketTest, UnknownSender) {
+  Address receiver_address(kLocalhost, 0);
+  UnixSocket receiver_socket(receiver_address);
+  sockaddr_un receiver = {};
+  receiver.sun_family = AF_UNIX;
+  const auto receiver_path =
+      TestUnixPath("127.0.0.1-" + std::to_string(receiver_address.port()));
+  std::strncpy(receiver.sun_path, receiver_path.c_str(),
+               sizeof(receiver.sun_path) - 1);
+
+  // Paths not naming an IP address and port are dropped, without resolving
+  // them
+  for (const auto& name :
+       {"x-abc", "localhost-1234", "127.0.0.1-70000", "127.0.0.1-", "x"}) {
+    const auto path = TestUnixPath(name);
+    sockaddr_un sender = {};
+    sender.sun_family = AF_UNIX;
+    std::strncpy(sender.sun_path, path.c_str(), sizeof(sender.sun_path) - 1);
+    const int s = socket(AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE(s, 0);
+    unlink(path.c_str());
+    ASSERT_EQ(0, bind(s, (struct sockaddr*)&sender, sizeof(sender)));
+    ASSERT_EQ(kTestMessage.length(),
+              sendto(s, kTestMessage.data(), kTestMessage.length(), 0,
+                     (struct sockaddr*)&receiver, sizeof(receiver)));
+    close(s);
+    unlink(path.c_str());
+  }
+
+  Address sender_address(kLocalhost, 0);
+  UnixSocket sender_socket(sender_address);
+  ASSERT_TRUE(sender_socket.Send(receiver_address, "unix", 4));
+
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ("unix", std::string(buffer, length));
+}
+
+TEST(UnixSocketTest, SendReliable_Busy) {
+  Address sender_address(kLocalhost, 0);
+  UnixSocket sender_socket(sender_address);
+  Address receiver_address(kLocalhost, 0);
+  UnixSocket receiver_socket(receiver_address);
+  ASSERT_TRUE(sender_socket.Reliable(receiver_address));
+
+  // Filling the receiver's queue doesn't block the sender
+  const std::string payload(1024, 'x');
+  auto delivery = Delivery::kSent;
+  while (delivery == Delivery::kSent) {
+    delivery = sender_socket.SendReliable(receiver_address, payload.data(),
+                                          payload.length());
+  }
+  ASSERT_EQ(Delivery::kBusy, delivery);
+  ASSERT_TRUE(sender_socket.Reliable(receiver_address));
+
+  // Room is made as the receiver catches up
+  Address from;
+  Address to;
+  char buffer[kMaxUDPPayload];
+  size_t length;
+  ASSERT_TRUE(receiver_socket.Receive(from, to, buffer, length));
+  ASSERT_EQ(Delivery::kSent,
+            sender_socket.SendReliable(receiver_address, payload.data(),
+                                       payload.length()));
+}
+
+TEST(UnixSocketTest, Mailbox_PeerGone) {
+  Address sender_address(kLocalhost, 0);
+  UnixSocket sender_socket(sender_address);
+  AsyncMailbox sender_mailbox(sender_socket);
+  Address receiver_address(kLocalhost, 0);
+  {
+    UnixSocket receiver_socket(receiver_address);
+    ASSERT_TRUE(sender_socket.Reliable(receiver_address));
+  }
+
+  // Peer is replaced by one only using the network, which the message is
+  // sequenced and acknowledged through instead of being lost
+  UDPSocket receiver_socket(receiver_address);
+  AsyncMailbox receiver_mailbox(receiver_socket);
+  sender_mailbox.Send(receiver_address, kTestMessage);
+
+  Address from;
+  Address to;
+  std::string message;
+  ASSERT_TRUE(receiver_mailbox.Receive(from, to, message));
+  ASSERT_EQ(sender_address, from);
+  ASSERT_EQ(kTestMessage, message);
+  ASSERT_TRUE(sender_mailbox.Flushed());
+  ASSERT_FALSE(sender_socket.Reliable(receiver_address));
+}
@@ -0,0 +1,106 @@
+// Copyright 2022-2025 Stuart Scott
+#include <Wink/window.h>
+#include <gtest/gtest.h>
+
+TEST(ReceiveWindowTest, Receive) {
+  ReceiveWindow window;
+  // First sequence number starts the window
+  ASSERT_TRUE(window.Receive(1000));
+  ASSERT_EQ(1000, window.cumulative());
+  ASSERT_EQ(0, window.selective());
+
+  ASSERT_TRUE(window.Receive(1001));
+  ASSERT_EQ(1001, window.cumulative());
+  ASSERT_EQ(0, window.selective());
+
+  // Duplicates
+  ASSERT_FALSE(window.Receive(1001));
+  ASSERT_FALSE(window.Receive(999));
+}
+
+TEST(ReceiveWindowTest, Receive_Start) {
+  ReceiveWindow window;
+  // Window starts from zero when the peer has only just started
+  ASSERT_TRUE(window.Receive(2));
+  ASSERT_EQ(0b100, window.selective());
+  ASSERT_TRUE(window.Receive(0));
+  ASSERT_EQ(0, window.cumulative());
+  ASSERT_EQ(0b10, window.selective());
+  ASSERT_TRUE(window.Receive(1));
+  ASSERT_EQ(2, window.cumulative());
+  ASSERT_EQ(0, window.selective());
+}
+
+TEST(ReceiveWindowTest, Receive_OutOfOrder) {
+  ReceiveWindow window;
+  ASSERT_TRUE(window.Receive(0));
+
+  ASSERT_TRUE(window.Receive(2));
+  ASSERT_TRUE(window.Receive(4));
+  ASSERT_EQ(0, window.cumulative());
+  ASSERT_EQ(0b1010, window.selective());
+  ASSERT_FALSE(window.Receive(4));
+
+  // Filling the gap advances the cumulative sequence number
+  ASSERT_TRUE(window.Receive(1));
+  ASSERT_EQ(2, window.cumulative());
+  ASSERT_EQ(0b10, window.selective());
+  ASSERT_TRUE(window.Receive(3));
+  ASSERT_EQ(4, window.cumulative());
+  ASSERT_EQ(0, window.selective());
+}
+
+TEST(ReceiveWindowTest, Receive_Slide) {
+  ReceiveWindow window;
+  ASSERT_TRUE(window.Receive(0));
+  ASSERT_TRUE(window.Receive(2));
+
+  // Receiving beyond the window gives up on the oldest gap
+  ASSERT_TRUE(window.Receive(65));
+  ASSERT_EQ(2, window.cumulative());
+  ASSERT_EQ(uint64_t(1) << 62, window.selective());
+  ASSERT_FALSE(window.Receive(1));
+
+  ASSERT_TRUE(window.Receive(1000));
+  ASSERT_EQ(936, window.cumulative());
+  ASSERT_EQ(uint64_t(1) << 63, window.selective());
+}
+
+TEST(ReceiveWindowTest, Receive_Wraparound) {
+  ReceiveWindow window;
+  const uint64_t max = -1;
+  ASSERT_TRUE(window.Receive(max - 1));
+
+  ASSERT_TRUE(window.Receive(1));
+  ASSERT_EQ(max - 1, window.cumulative());
+  ASSERT_EQ(0b100, window.selective());
+  ASSERT_TRUE(window.Receive(max));
+  ASSERT_TRUE(window.Receive(0));
+  ASSERT_EQ(1, window.cumulative());
+  ASSERT_EQ(0, window.selective());
+
+  // Sequence numbers before the wraparound are duplicates
+  ASSERT_FALSE(window.Receive(max));
+  ASSERT_FALSE(window.Receive(max - 100));
+}
+
+TEST(ReceiveWindowTest, Skip) {
+  ReceiveWindow window;
+  ASSERT_TRUE(window.Receive(0));
+  ASSERT_TRUE(window.Receive(3));
+  ASSERT_TRUE(window.Receive(6));
+
+  // Gives up on the gap before 3, but not the one after it
+  window.Skip(3);
+  ASSERT_EQ(3, window.cumulative());
+  ASSERT_EQ(0b100, window.selective());
+  ASSERT_FALSE(window.Receive(1));
+  ASSERT_FALSE(window.Receive(2));
+
+  // Nothing to give up on
+  window.Skip(2);
+  ASSERT_EQ(3, window.cumulative());
+
+  ASSERT_TRUE(window.Receive(4));
+  ASSERT_EQ(4, window.cumulative());
+}